@@ -0,0 +1,283 @@
+/* ner: src/charset_converter.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <strings.h>
+#include <gmime/gmime.h>
+
+#include "charset_converter.hh"
+
+const char replacementCharacter[] = "\xef\xbf\xbd";
+
+/* Charsets whose text is already UTF-8 if it is valid */
+static bool isUtf8(const char * charset)
+{
+    const char * names[] = { "utf-8", "utf8", "us-ascii", "ascii" };
+
+    for (auto name = std::begin(names), e = std::end(names); name != e; ++name)
+    {
+        if (strcasecmp(charset, *name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Returns the end of the valid UTF-8 at the start of the text.
+ *
+ * Mail is mostly ASCII, so that is skipped sixteen bytes at a time.
+ */
+static const char * validUtf8(const char * data, const char * end)
+{
+    const unsigned char * position = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char * textEnd = reinterpret_cast<const unsigned char *>(end);
+
+    while (position < textEnd)
+    {
+        while (textEnd - position >= 16)
+        {
+            uint64_t first, second;
+
+            std::memcpy(&first, position, 8);
+            std::memcpy(&second, position + 8, 8);
+
+            if ((first | second) & UINT64_C(0x8080808080808080))
+                break;
+
+            position += 16;
+        }
+
+        if (position == textEnd)
+            break;
+
+        unsigned char character = *position;
+
+        if (character < 0x80)
+        {
+            ++position;
+            continue;
+        }
+
+        /* The range of the second byte excludes overlong forms, surrogates
+         * and code points past U+10FFFF */
+        int length;
+        unsigned char low = 0x80, high = 0xbf;
+
+        if (character >= 0xc2 && character <= 0xdf)
+            length = 2;
+        else if (character >= 0xe0 && character <= 0xef)
+        {
+            length = 3;
+
+            if (character == 0xe0)
+                low = 0xa0;
+            else if (character == 0xed)
+                high = 0x9f;
+        }
+        else if (character >= 0xf0 && character <= 0xf4)
+        {
+            length = 4;
+
+            if (character == 0xf0)
+                low = 0x90;
+            else if (character == 0xf4)
+                high = 0x8f;
+        }
+        else
+            break;
+
+        if (textEnd - position < length || position[1] < low || position[1] > high)
+            break;
+
+        int index = 2;
+
+        while (index < length && (position[index] & 0xc0) == 0x80)
+            ++index;
+
+        if (index < length)
+            break;
+
+        position += length;
+    }
+
+    return reinterpret_cast<const char *>(position);
+}
+
+/* Returns whether the text is the start of a character which may be
+ * completed by more text */
+static bool isIncomplete(const char * data, const char * end)
+{
+    unsigned char character = *data;
+    int length;
+
+    if (character >= 0xc2 && character <= 0xdf)
+        length = 2;
+    else if (character >= 0xe0 && character <= 0xef)
+        length = 3;
+    else if (character >= 0xf0 && character <= 0xf4)
+        length = 4;
+    else
+        return false;
+
+    if (end - data >= length)
+        return false;
+
+    for (const char * position = data + 1; position < end; ++position)
+    {
+        if ((*position & 0xc0) != 0x80)
+            return false;
+    }
+
+    return true;
+}
+
+CharsetConverter::CharsetConverter(const char * charset)
+    : _mode(PassThrough), _iconv(iconv_t(-1))
+{
+    if (!charset)
+        return;
+
+    if (!isUtf8(charset))
+        _iconv = g_mime_iconv_open("UTF-8", charset);
+
+    /* If we don't know the charset, the best we can do is to keep the text
+     * which happens to be valid */
+    _mode = _iconv == iconv_t(-1) ? Validate : Iconv;
+}
+
+CharsetConverter::~CharsetConverter()
+{
+    if (_iconv != iconv_t(-1))
+    {
+        /* Reset the shift state before it is reused */
+        iconv(_iconv, 0, 0, 0, 0);
+        g_mime_iconv_close(_iconv);
+    }
+}
+
+void CharsetConverter::convert(const char * data, size_t length, std::string & output)
+{
+    switch (_mode)
+    {
+        case PassThrough:
+            output.append(data, length);
+            break;
+
+        case Validate:
+        {
+            /* Complete the character held back from the last block */
+            while (!_pending.empty() && length > 0)
+            {
+                _pending.push_back(*data++);
+                --length;
+
+                const char * rest = validate(_pending.data(), _pending.data() + _pending.size(), output);
+                _pending.erase(0, rest - _pending.data());
+            }
+
+            const char * rest = validate(data, data + length, output);
+            _pending.append(rest, data + length);
+            break;
+        }
+
+        case Iconv:
+            if (_pending.empty())
+                convertWithIconv(data, length, output);
+            else
+            {
+                std::string text;
+                text.swap(_pending);
+                text.append(data, length);
+                convertWithIconv(text.data(), text.size(), output);
+            }
+            break;
+    }
+}
+
+void CharsetConverter::finish(std::string & output)
+{
+    if (_pending.empty())
+        return;
+
+    output.append(replacementCharacter);
+    _pending.clear();
+}
+
+const char * CharsetConverter::validate(const char * data, const char * end, std::string & output)
+{
+    while (data < end)
+    {
+        const char * valid = validUtf8(data, end);
+
+        output.append(data, valid);
+        data = valid;
+
+        if (data == end || isIncomplete(data, end))
+            break;
+
+        output.append(replacementCharacter);
+        ++data;
+    }
+
+    return data;
+}
+
+void CharsetConverter::convertWithIconv(const char * data, size_t length, std::string & output)
+{
+    char * input = const_cast<char *>(data);
+    size_t inputLeft = length;
+
+    while (inputLeft > 0)
+    {
+        size_t start = output.size();
+        output.resize(start + inputLeft * 2 + 16);
+
+        char * converted = &output[start];
+        size_t outputLeft = output.size() - start;
+
+        size_t result = iconv(_iconv, &input, &inputLeft, &converted, &outputLeft);
+
+        output.resize(output.size() - outputLeft);
+
+        if (result == size_t(-1))
+        {
+            if (errno == EILSEQ)
+            {
+                output.append(replacementCharacter);
+                ++input;
+                --inputLeft;
+            }
+            else if (errno == EINVAL)
+            {
+                /* The rest may be completed by the next block */
+                _pending.assign(input, inputLeft);
+                break;
+            }
+            else if (errno != E2BIG)
+                break;
+        }
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
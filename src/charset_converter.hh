@@ -0,0 +1,77 @@
+/* ner: src/charset_converter.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_CHARSET_CONVERTER_H
+#define NER_CHARSET_CONVERTER_H 1
+
+#include <string>
+#include <iconv.h>
+
+/**
+ * Converts text in some charset to UTF-8, a block at a time.
+ *
+ * Text which is supposed to be UTF-8 or ASCII is only validated, which is
+ * much faster than running it through iconv. Invalid sequences are replaced
+ * with U+FFFD.
+ */
+class CharsetConverter
+{
+    public:
+        /**
+         * \param charset The charset of the text, or 0 to pass it through
+         *                unchanged.
+         */
+        CharsetConverter(const char * charset);
+        CharsetConverter(const CharsetConverter &) = delete;
+        CharsetConverter & operator=(const CharsetConverter &) = delete;
+        ~CharsetConverter();
+
+        /**
+         * Converts the next block of text, appending it to the output.
+         *
+         * An incomplete character at the end of the block is held back until
+         * the next call.
+         */
+        void convert(const char * data, size_t length, std::string & output);
+
+        /**
+         * Finishes the text, replacing any incomplete character.
+         */
+        void finish(std::string & output);
+
+    private:
+        enum Mode
+        {
+            PassThrough,
+            Validate,
+            Iconv
+        };
+
+        const char * validate(const char * data, const char * end, std::string & output);
+        void convertWithIconv(const char * data, size_t length, std::string & output);
+
+        Mode _mode;
+        iconv_t _iconv;
+        std::string _pending;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -0,0 +1,285 @@
+/* ner: src/database_pool.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include "database_pool.hh"
+#include "notmuch.hh"
+
+using namespace NotMuch;
+
+/* The maximum number of idle read-only handles to keep around */
+const int maxIdleHandles = 4;
+
+/* Files whose metadata changes whenever Xapian commits a new revision */
+const char * const xapianFiles[] = {
+    "",
+    "iamglass",
+    "iamchert",
+    "record.baseA",
+    "record.baseB",
+    "postlist.baseA",
+    "postlist.baseB",
+};
+
+Database::Database(notmuch_database_mode_t mode)
+    : _mode(mode)
+{
+    _database = DatabasePool::instance().acquire(mode, _generation);
+}
+
+Database::~Database()
+{
+    DatabasePool::instance().release(_database, _mode, _generation);
+}
+
+unsigned long Database::revision(std::string * uuid) const
+{
+    const char * databaseUuid;
+    unsigned long revision = notmuch_database_get_revision(_database, &databaseUuid);
+
+    if (uuid)
+        *uuid = databaseUuid;
+
+    return revision;
+}
+
+DatabasePool & DatabasePool::instance()
+{
+    static DatabasePool * pool = NULL;
+    static std::once_flag created;
+
+    std::call_once(created, [] { pool = new DatabasePool(); });
+
+    return *pool;
+}
+
+DatabasePool::DatabasePool()
+    : _writing(false), _generation(0), _revision(0)
+{
+    char * path = g_key_file_get_string(NotMuch::config(), "database", "path", NULL);
+
+    if (path)
+    {
+        _path = path;
+        g_free(path);
+    }
+
+    _xapianPath = _path + "/.notmuch/xapian/";
+    _stamp = stamp();
+}
+
+DatabasePool::~DatabasePool()
+{
+    for (auto handle = _idle.begin(), e = _idle.end(); handle != e; ++handle)
+        notmuch_database_destroy(handle->database);
+}
+
+notmuch_database_t * DatabasePool::acquire(notmuch_database_mode_t mode, unsigned & generation)
+{
+    std::vector<notmuch_database_t *> stale;
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (mode == NOTMUCH_DATABASE_MODE_READ_WRITE)
+    {
+        _writerReleased.wait(lock, [this] { return !_writing; });
+        _writing = true;
+        generation = _generation;
+        lock.unlock();
+
+        try
+        {
+            return open(mode);
+        }
+        catch (...)
+        {
+            lock.lock();
+            _writing = false;
+            _writerReleased.notify_one();
+            throw;
+        }
+    }
+
+    if (checkStamp())
+        invalidateLocked(stale);
+
+    generation = _generation;
+
+    notmuch_database_t * database = NULL;
+
+    if (!_idle.empty())
+    {
+        database = _idle.back().database;
+        _idle.pop_back();
+    }
+
+    lock.unlock();
+
+    for (auto handle = stale.begin(), e = stale.end(); handle != e; ++handle)
+        notmuch_database_destroy(*handle);
+
+    if (!database)
+        database = open(mode);
+
+    return database;
+}
+
+void DatabasePool::release(notmuch_database_t * database, notmuch_database_mode_t mode,
+    unsigned generation)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (mode == NOTMUCH_DATABASE_MODE_READ_WRITE)
+    {
+        std::vector<notmuch_database_t *> stale;
+
+        /* Anything we wrote is only visible to freshly opened handles */
+        invalidateLocked(stale);
+        _writing = false;
+        _writerReleased.notify_one();
+        lock.unlock();
+
+        stale.push_back(database);
+
+        for (auto handle = stale.begin(), e = stale.end(); handle != e; ++handle)
+            notmuch_database_destroy(*handle);
+    }
+    else if (generation == _generation && _idle.size() < maxIdleHandles)
+        _idle.push_back(Handle{ database, generation });
+    else
+    {
+        lock.unlock();
+        notmuch_database_destroy(database);
+    }
+}
+
+unsigned long DatabasePool::revision()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _revision;
+}
+
+std::string DatabasePool::uuid()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _uuid;
+}
+
+unsigned DatabasePool::generation()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _generation;
+}
+
+bool DatabasePool::checkForChanges()
+{
+    std::vector<notmuch_database_t *> stale;
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (!checkStamp())
+        return false;
+
+    invalidateLocked(stale);
+    lock.unlock();
+
+    for (auto handle = stale.begin(), e = stale.end(); handle != e; ++handle)
+        notmuch_database_destroy(*handle);
+
+    return true;
+}
+
+void DatabasePool::invalidate()
+{
+    std::vector<notmuch_database_t *> stale;
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _stamp = stamp();
+    invalidateLocked(stale);
+    lock.unlock();
+
+    for (auto handle = stale.begin(), e = stale.end(); handle != e; ++handle)
+        notmuch_database_destroy(*handle);
+}
+
+notmuch_database_t * DatabasePool::open(notmuch_database_mode_t mode)
+{
+    notmuch_database_t * database;
+    notmuch_status_t status = notmuch_database_open(_path.c_str(), mode, &database);
+
+    if (status != NOTMUCH_STATUS_SUCCESS)
+        throw std::runtime_error("Open database failed: " +
+            std::string(notmuch_status_to_string(status)));
+
+    const char * uuid;
+    unsigned long revision = notmuch_database_get_revision(database, &uuid);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (uuid != _uuid || revision > _revision)
+    {
+        _revision = revision;
+        _uuid = uuid;
+    }
+
+    return database;
+}
+
+std::string DatabasePool::stamp() const
+{
+    std::ostringstream stamp;
+
+    for (auto file = std::begin(xapianFiles), e = std::end(xapianFiles); file != e; ++file)
+    {
+        struct stat info;
+
+        if (stat((_xapianPath + *file).c_str(), &info) == 0)
+        {
+            stamp << info.st_ino << ':' << info.st_size << ':'
+                << info.st_mtim.tv_sec << '.' << info.st_mtim.tv_nsec << ';';
+        }
+    }
+
+    return stamp.str();
+}
+
+bool DatabasePool::checkStamp()
+{
+    std::string current(stamp());
+
+    if (current == _stamp)
+        return false;
+
+    _stamp = current;
+
+    return true;
+}
+
+void DatabasePool::invalidateLocked(std::vector<notmuch_database_t *> & stale)
+{
+    ++_generation;
+
+    for (auto handle = _idle.begin(), e = _idle.end(); handle != e; ++handle)
+        stale.push_back(handle->database);
+
+    _idle.clear();
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
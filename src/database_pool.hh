@@ -0,0 +1,154 @@
+/* ner: src/database_pool.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_DATABASE_POOL_H
+#define NER_DATABASE_POOL_H 1
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <notmuch.h>
+
+namespace NotMuch
+{
+    /**
+     * A handle to the notmuch database, borrowed from the DatabasePool.
+     *
+     * The handle is given back to the pool when the Database goes out of
+     * scope, so any queries or messages created from it must be destroyed
+     * first. A Database must only be used by the thread that created it.
+     */
+    class Database
+    {
+        public:
+            Database(notmuch_database_mode_t mode = NOTMUCH_DATABASE_MODE_READ_ONLY);
+            Database(const Database &) = delete;
+            Database & operator=(const Database &) = delete;
+            ~Database();
+
+            operator notmuch_database_t *() const { return _database; }
+
+            /**
+             * Returns the revision of the database as seen by this handle.
+             *
+             * \param uuid If non-null, set to the UUID of the database.
+             */
+            unsigned long revision(std::string * uuid = NULL) const;
+
+        private:
+            notmuch_database_t * _database;
+            notmuch_database_mode_t _mode;
+            unsigned _generation;
+    };
+
+    /**
+     * Keeps database handles open between operations.
+     *
+     * Read-only handles are reused until the database changes on disk, at
+     * which point they are reopened so that they see the new revision.
+     * There is at most one writer at a time; the writable handle is closed as
+     * soon as it is released so that we do not hold Xapian's write lock while
+     * idle.
+     *
+     * This class is a singleton, and may be used from any thread.
+     */
+    class DatabasePool
+    {
+        public:
+            static DatabasePool & instance();
+
+            /**
+             * Returns the path of the notmuch database.
+             */
+            const std::string & path() const { return _path; }
+
+            notmuch_database_t * acquire(notmuch_database_mode_t mode, unsigned & generation);
+            void release(notmuch_database_t * database, notmuch_database_mode_t mode,
+                unsigned generation);
+
+            /**
+             * Returns the most recent database revision seen by any handle.
+             */
+            unsigned long revision();
+
+            /**
+             * Returns the UUID of the database that revision() refers to.
+             *
+             * Revisions are only comparable between equal UUIDs.
+             */
+            std::string uuid();
+
+            /**
+             * Returns a number that changes whenever the pool notices that
+             * the database may have changed.
+             */
+            unsigned generation();
+
+            /**
+             * Checks whether the database has changed on disk, and if so,
+             * causes subsequently acquired handles to be reopened.
+             *
+             * \return Whether the database changed.
+             */
+            bool checkForChanges();
+
+            /**
+             * Unconditionally reopens handles on their next use.
+             */
+            void invalidate();
+
+        private:
+            struct Handle
+            {
+                notmuch_database_t * database;
+                unsigned generation;
+            };
+
+            DatabasePool();
+            ~DatabasePool();
+
+            notmuch_database_t * open(notmuch_database_mode_t mode);
+            std::string stamp() const;
+
+            /* Requires _mutex */
+            bool checkStamp();
+            void invalidateLocked(std::vector<notmuch_database_t *> & stale);
+
+            std::string _path;
+            std::string _xapianPath;
+
+            std::mutex _mutex;
+            std::condition_variable _writerReleased;
+
+            std::vector<Handle> _idle;
+            bool _writing;
+
+            unsigned _generation;
+            std::string _stamp;
+
+            unsigned long _revision;
+            std::string _uuid;
+    };
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
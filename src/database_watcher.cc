@@ -0,0 +1,119 @@
+/* ner: src/database_watcher.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "database_watcher.hh"
+#include "database_pool.hh"
+#include "event_loop.hh"
+#include "view_manager.hh"
+
+/* How long to wait for a burst of changes to settle before checking */
+const auto checkDelay = std::chrono::milliseconds(300);
+
+DatabaseWatcher::DatabaseWatcher()
+    : _notmuchPath(NotMuch::DatabasePool::instance().path() + "/.notmuch"),
+        _xapianPath(_notmuchPath + "/xapian"),
+        _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+        _xapianWatch(-1),
+        _checkTimer(0),
+        _generation(NotMuch::DatabasePool::instance().generation())
+{
+    if (_fd == -1)
+        return;
+
+    /* Compacting the database replaces the Xapian directory */
+    inotify_add_watch(_fd, _notmuchPath.c_str(), IN_CREATE | IN_MOVED_TO);
+    watchXapian();
+
+    EventLoop::instance().watch(_fd, std::bind(&DatabaseWatcher::readEvents, this));
+}
+
+DatabaseWatcher::~DatabaseWatcher()
+{
+    if (_checkTimer)
+        EventLoop::instance().cancelTimer(_checkTimer);
+
+    if (_fd != -1)
+    {
+        EventLoop::instance().unwatch(_fd);
+        close(_fd);
+    }
+}
+
+void DatabaseWatcher::check()
+{
+    NotMuch::DatabasePool & pool = NotMuch::DatabasePool::instance();
+
+    /* The generation also changes when we write to the database ourselves,
+     * or when a handle notices a change first */
+    pool.checkForChanges();
+
+    if (pool.generation() != _generation)
+    {
+        _generation = pool.generation();
+        ViewManager::instance().databaseChanged();
+    }
+}
+
+void DatabaseWatcher::readEvents()
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+    ssize_t length;
+    bool changed = false;
+    bool replaced = false;
+
+    while ((length = read(_fd, buffer, sizeof buffer)) > 0)
+    {
+        const inotify_event * event;
+
+        for (char * position = buffer; position < buffer + length;
+            position += sizeof(inotify_event) + event->len)
+        {
+            event = reinterpret_cast<const inotify_event *>(position);
+
+            if (event->wd == _xapianWatch)
+                changed = true;
+            else if (event->len > 0 && std::strcmp(event->name, "xapian") == 0)
+                changed = replaced = true;
+        }
+    }
+
+    if (replaced)
+        watchXapian();
+
+    if (changed && !_checkTimer)
+    {
+        _checkTimer = EventLoop::instance().addTimer(checkDelay, [this] {
+            _checkTimer = 0;
+            check();
+        });
+    }
+}
+
+void DatabaseWatcher::watchXapian()
+{
+    _xapianWatch = inotify_add_watch(_fd, _xapianPath.c_str(),
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -0,0 +1,62 @@
+/* ner: src/database_watcher.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_DATABASE_WATCHER_H
+#define NER_DATABASE_WATCHER_H 1
+
+#include <string>
+
+/**
+ * Watches the notmuch database with inotify, and tells the open views when
+ * it has changed.
+ *
+ * Changes are debounced, since a single notmuch operation touches several
+ * files. If inotify is not available, changes are only noticed when check()
+ * is called.
+ */
+class DatabaseWatcher
+{
+    public:
+        DatabaseWatcher();
+        ~DatabaseWatcher();
+
+        /**
+         * Checks whether the database has changed, and if so, tells the
+         * views.
+         */
+        void check();
+
+    private:
+        void readEvents();
+        void watchXapian();
+
+        std::string _notmuchPath;
+        std::string _xapianPath;
+
+        int _fd;
+        int _xapianWatch;
+        int _checkTimer;
+
+        unsigned _generation;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
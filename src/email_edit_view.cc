@@ -22,6 +22,8 @@
 #include <sstream>
 #include <cstring>
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <gio/gio.h>
 #include <gmime/gmime.h>
@@ -63,7 +65,11 @@ void EmailEditView::edit()
     std::string command(NerConfig::instance().command("edit"));
     command.push_back(' ');
     command.append(_messageFile);
-    std::system(command.c_str());
+
+    pid_t pid = spawnCommand(command);
+
+    if (pid != -1)
+        waitForProcess(pid);
 
     PartList partsBackup;
     partsBackup.swap(_parts); // parts will be cleared anyway
@@ -146,13 +152,25 @@ void EmailEditView::send()
     /* Send the message */
     std::string sendCommand = _identity->sendCommand.empty() ?
         NerConfig::instance().command("send") : _identity->sendCommand;
-    FILE * sendMailPipe = popen(sendCommand.c_str(), "w");
-    GMimeStream * sendMailStream = g_mime_stream_file_new(sendMailPipe);
-    g_mime_stream_file_set_owner(GMIME_STREAM_FILE(sendMailStream), false);
-    g_mime_object_write_to_stream(GMIME_OBJECT(message), sendMailStream);
-    g_object_unref(sendMailStream);
+    int status = -1;
+    int sendMailPipe[2];
+
+    if (pipe2(sendMailPipe, O_CLOEXEC) == 0)
+    {
+        pid_t pid = spawnCommand(sendCommand, sendMailPipe[0]);
+        close(sendMailPipe[0]);
 
-    int status = pclose(sendMailPipe);
+        if (pid != -1)
+        {
+            GMimeStream * sendMailStream = g_mime_stream_fs_new(sendMailPipe[1]);
+            g_mime_object_write_to_stream(GMIME_OBJECT(message), sendMailStream);
+            g_object_unref(sendMailStream);
+
+            status = waitForProcess(pid);
+        }
+        else
+            close(sendMailPipe[1]);
+    }
 
     if (status == 0)
     {
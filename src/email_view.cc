@@ -19,6 +19,7 @@
  */
 
 #include "email_view.hh"
+#include "message_cache.hh"
 #include "colors.hh"
 #include "ncurses.hh"
 #include "util.hh"
@@ -48,35 +49,18 @@ EmailView::~EmailView()
 void EmailView::setEmail(const std::string & filename)
 {
     _parts.clear();
+    _unfoldedParts.clear();
 
-    FILE * file = fopen(filename.c_str(), "r");
+    /* The parsed message is shared with any other views showing it */
+    std::shared_ptr<const ParsedMessage> message(MessageCache::instance().message(filename));
 
-    if (file != NULL)
+    if (message)
     {
-        GMimeStream * stream = g_mime_stream_file_new(file);
-        GMimeParser * parser = g_mime_parser_new_with_stream(stream);
-        GMimeMessage * message = g_mime_parser_construct_message(parser);
-
-        /* Read relavant headers */
-        _headers = {
-            { "To",         internet_address_list_to_string(g_mime_message_get_recipients(message,
-                GMIME_RECIPIENT_TYPE_TO), true) ? : "(null)" },
-            { "From",       g_mime_message_get_sender(message) ? : "(null)" },
-            { "Cc",         internet_address_list_to_string(g_mime_message_get_recipients(message,
-                GMIME_RECIPIENT_TYPE_CC), true) ? : "(null)" },
-            { "Bcc",         internet_address_list_to_string(g_mime_message_get_recipients(message,
-                GMIME_RECIPIENT_TYPE_BCC), true) ? : "(null)" },
-            { "Subject",    g_mime_message_get_subject(message) ? : "(null)" }
-        };
-
-        GMimeObject * mimePart = g_mime_message_get_mime_part(message);
-
-        /* Locate plain text parts */
-        processMimePart(mimePart, std::back_inserter(_parts));
-        if (not _parts.empty())
-            _parts[0]->folded = false;
+        _headers = message->headers;
+        _parts = message->parts;
 
-        g_object_unref(mimePart);
+        if (not _parts.empty())
+            _unfoldedParts.insert(_parts[0].get());
     }
 }
 
@@ -120,7 +104,7 @@ void EmailView::update()
     ++row;
 
     MessagePartDisplayVisitor displayVisitor(_window, View::Geometry{ 0, row,
-        _geometry.width, visibleLines() }, _offset, _selectedIndex);
+        _geometry.width, visibleLines() }, _offset, _selectedIndex, _unfoldedParts);
 
 
     for (auto part = _parts.begin(), e = _parts.end(); part != e; ++part)
@@ -165,7 +149,9 @@ void EmailView::saveSelectedPart()
 void EmailView::toggleSelectedPartFolding()
 {
     PartList::iterator part = selectedPart();
-    (*part)->folded = not (*part)->folded;
+
+    if (!_unfoldedParts.erase(part->get()))
+        _unfoldedParts.insert(part->get());
 
     if (part != _parts.begin())
         _selectedIndex = _partsEndLine[std::distance(_parts.begin(), part) - 1];
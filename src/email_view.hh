@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <gmime/gmime.h>
 
 #include "line_browser_view.hh"
@@ -55,6 +56,7 @@ class EmailView : public LineBrowserView
         std::vector<std::string> _visibleHeaders;
 
         PartList _parts;
+        std::set<const MessagePart *> _unfoldedParts;
         std::vector<int> _partsEndLine;
 };
 
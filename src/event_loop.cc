@@ -0,0 +1,209 @@
+/* ner: src/event_loop.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include "event_loop.hh"
+
+EventLoop * EventLoop::_instance = 0;
+
+static void handledSignals(sigset_t & signals)
+{
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGWINCH);
+    sigaddset(&signals, SIGTSTP);
+}
+
+void EventLoop::unblockSignals()
+{
+    sigset_t signals;
+    handledSignals(signals);
+
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+}
+
+EventLoop::EventLoop()
+    : _running(false)
+{
+    _instance = this;
+
+    sigset_t signals;
+    handledSignals(signals);
+
+    /* Block the signals so that they are only delivered through the
+     * signalfd; threads started later inherit this mask */
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    _signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (_signalFd == -1 || _wakeFd == -1)
+        throw std::runtime_error(std::string("Cannot create event loop: ") + std::strerror(errno));
+}
+
+EventLoop::~EventLoop()
+{
+    close(_signalFd);
+    close(_wakeFd);
+
+    _instance = 0;
+}
+
+void EventLoop::run()
+{
+    _running = true;
+
+    while (_running)
+    {
+        std::vector<pollfd> fds{
+            { _wakeFd, POLLIN, 0 },
+            { _signalFd, POLLIN, 0 }
+        };
+
+        for (auto watch = _watches.begin(), e = _watches.end(); watch != e; ++watch)
+            fds.push_back(pollfd{ watch->first, POLLIN, 0 });
+
+        /* Sleep until the next timer is due */
+        if (poll(fds.data(), fds.size(), _timers.timeUntilNext()) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+
+        if (fds[1].revents & POLLIN)
+            readSignals();
+
+        if (fds[0].revents & POLLIN)
+            runPosted();
+
+        for (auto fd = fds.begin() + 2, e = fds.end(); fd != e && _running; ++fd)
+        {
+            if (!(fd->revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            /* The callback may change the watches */
+            auto watch = _watches.find(fd->fd);
+
+            if (watch != _watches.end())
+            {
+                std::function<void ()> callback(watch->second);
+                callback();
+            }
+        }
+
+        if (_running)
+            _timers.expire();
+    }
+}
+
+void EventLoop::quit()
+{
+    _running = false;
+}
+
+void EventLoop::watch(int fd, const std::function<void ()> & callback)
+{
+    _watches[fd] = callback;
+}
+
+void EventLoop::unwatch(int fd)
+{
+    _watches.erase(fd);
+}
+
+void EventLoop::handleSignal(int signal, const std::function<void ()> & handler)
+{
+    _signalHandlers[signal] = handler;
+}
+
+int EventLoop::addTimer(std::chrono::milliseconds delay, const std::function<void ()> & callback)
+{
+    return _timers.add(delay, callback);
+}
+
+int EventLoop::addPeriodicTimer(std::chrono::milliseconds delay,
+    std::chrono::milliseconds interval, const std::function<void ()> & callback)
+{
+    return _timers.add(delay, callback, interval);
+}
+
+void EventLoop::cancelTimer(int id)
+{
+    _timers.cancel(id);
+}
+
+void EventLoop::post(const std::function<void ()> & callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _posted.push_back(callback);
+    }
+
+    uint64_t count = 1;
+
+    /* EAGAIN means the counter is full, so the loop will wake up anyway */
+    while (write(_wakeFd, &count, sizeof count) == -1 && errno == EINTR)
+        continue;
+}
+
+void EventLoop::runPosted()
+{
+    uint64_t count;
+
+    /* EAGAIN means another wakeup already reset the counter */
+    while (read(_wakeFd, &count, sizeof count) == -1 && errno == EINTR)
+        continue;
+
+    std::deque<std::function<void ()>> posted;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        posted.swap(_posted);
+    }
+
+    for (auto callback = posted.begin(), e = posted.end(); callback != e; ++callback)
+        (*callback)();
+}
+
+void EventLoop::readSignals()
+{
+    signalfd_siginfo info;
+
+    while (read(_signalFd, &info, sizeof info) == sizeof info)
+    {
+        auto handler = _signalHandlers.find(info.ssi_signo);
+
+        if (handler != _signalHandlers.end())
+            handler->second();
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
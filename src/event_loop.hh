@@ -0,0 +1,123 @@
+/* ner: src/event_loop.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_EVENT_LOOP_H
+#define NER_EVENT_LOOP_H 1
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+#include "timer_wheel.hh"
+
+/**
+ * Dispatches input, timers, signals and callbacks from other threads on the
+ * UI thread.
+ *
+ * SIGWINCH and SIGTSTP are blocked when the loop is created and delivered
+ * through a signalfd instead, so the loop must be created before any other
+ * threads are started.
+ *
+ * This class is a singleton. Only post() may be called from other threads.
+ */
+class EventLoop
+{
+    public:
+        static EventLoop & instance()
+        {
+            return *_instance;
+        }
+
+        /**
+         * Unblocks the signals blocked by the loop. This must be called in
+         * child processes before they exec another program.
+         */
+        static void unblockSignals();
+
+        EventLoop();
+        ~EventLoop();
+
+        /**
+         * Runs until quit() is called.
+         */
+        void run();
+        void quit();
+
+        /**
+         * Calls the callback whenever the file descriptor becomes readable.
+         */
+        void watch(int fd, const std::function<void ()> & callback);
+        void unwatch(int fd);
+
+        /**
+         * Calls the handler whenever the signal is received.
+         *
+         * \param signal Either SIGWINCH or SIGTSTP.
+         */
+        void handleSignal(int signal, const std::function<void ()> & handler);
+
+        /**
+         * Calls the callback once, after the given delay.
+         *
+         * \return An ID which can be passed to cancelTimer().
+         */
+        int addTimer(std::chrono::milliseconds delay, const std::function<void ()> & callback);
+
+        /**
+         * Calls the callback every interval, starting after the given delay.
+         *
+         * \return An ID which can be passed to cancelTimer().
+         */
+        int addPeriodicTimer(std::chrono::milliseconds delay, std::chrono::milliseconds interval,
+            const std::function<void ()> & callback);
+        void cancelTimer(int id);
+
+        /**
+         * Queues the callback to be called from the loop.
+         *
+         * This may be called from any thread.
+         */
+        void post(const std::function<void ()> & callback);
+
+    private:
+        static EventLoop * _instance;
+
+        void runPosted();
+        void readSignals();
+
+        bool _running;
+
+        int _wakeFd;
+        int _signalFd;
+
+        std::map<int, std::function<void ()>> _watches;
+        std::map<int, std::function<void ()>> _signalHandlers;
+
+        TimerWheel _timers;
+
+        std::mutex _mutex;
+        std::deque<std::function<void ()>> _posted;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
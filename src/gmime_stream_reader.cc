@@ -0,0 +1,44 @@
+/* ner: src/gmime_stream_reader.cc
+ *
+ * Copyright (c) 2010 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "gmime_stream_reader.hh"
+
+/* Most parts are small, but large ones shouldn't be read 4KiB at a time */
+const size_t minimumBlockSize = 4096;
+const size_t maximumBlockSize = 256 * 1024;
+
+void readStream(GMimeStream * stream,
+    const std::function<void (const char *, size_t)> & function)
+{
+    std::vector<char> buffer(minimumBlockSize);
+    ssize_t length;
+
+    while ((length = g_mime_stream_read(stream, buffer.data(), buffer.size())) > 0)
+    {
+        function(buffer.data(), length);
+
+        if (size_t(length) == buffer.size() && buffer.size() < maximumBlockSize)
+            buffer.resize(buffer.size() * 2);
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
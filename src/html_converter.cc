@@ -0,0 +1,535 @@
+/* ner: src/html_converter.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <set>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+
+#include "html_converter.hh"
+
+/* Longer tags and entities are cut short, to bound memory use */
+const size_t maxTagLength = 2048;
+const size_t maxEntityLength = 32;
+
+const int horizontalRuleWidth = 40;
+
+static const std::set<std::string> paragraphTags = {
+    "p", "h1", "h2", "h3", "h4", "h5", "h6", "table", "dl", "pre", "blockquote"
+};
+
+static const std::set<std::string> lineTags = {
+    "div", "tr", "dt", "dd", "li", "ul", "ol", "form", "address", "center", "caption",
+    "section", "article", "header", "footer", "nav", "aside", "main", "figure"
+};
+
+/* Tags whose contents aren't displayed */
+static const std::set<std::string> skippedTags = {
+    "head", "title", "script", "style", "template"
+};
+
+static const std::map<std::string, std::string> namedEntities = {
+    { "amp",    "&" },
+    { "lt",     "<" },
+    { "gt",     ">" },
+    { "quot",   "\"" },
+    { "apos",   "'" },
+    { "nbsp",   " " },
+    { "copy",   "©" },
+    { "reg",    "®" },
+    { "trade",  "™" },
+    { "hellip", "…" },
+    { "mdash",  "—" },
+    { "ndash",  "–" },
+    { "lsquo",  "‘" },
+    { "rsquo",  "’" },
+    { "ldquo",  "“" },
+    { "rdquo",  "”" },
+    { "laquo",  "«" },
+    { "raquo",  "»" },
+    { "bull",   "•" },
+    { "middot", "·" },
+    { "deg",    "°" },
+    { "times",  "×" },
+    { "divide", "÷" },
+    { "euro",   "€" },
+    { "pound",  "£" },
+    { "yen",    "¥" },
+    { "cent",   "¢" },
+    { "sect",   "§" },
+    { "para",   "¶" },
+    { "shy",    "" },
+    { "zwnj",   "" },
+    { "zwj",    "" },
+};
+
+static std::string encodeUtf8(unsigned long codePoint)
+{
+    std::string text;
+
+    /* Surrogates and anything past U+10FFFF can't be encoded */
+    if (codePoint == 0 || (codePoint >= 0xd800 && codePoint <= 0xdfff)
+        || codePoint > 0x10ffff)
+        codePoint = 0xfffd;
+
+    if (codePoint < 0x80)
+        text.push_back(codePoint);
+    else if (codePoint < 0x800)
+    {
+        text.push_back(0xc0 | (codePoint >> 6));
+        text.push_back(0x80 | (codePoint & 0x3f));
+    }
+    else if (codePoint < 0x10000)
+    {
+        text.push_back(0xe0 | (codePoint >> 12));
+        text.push_back(0x80 | ((codePoint >> 6) & 0x3f));
+        text.push_back(0x80 | (codePoint & 0x3f));
+    }
+    else
+    {
+        text.push_back(0xf0 | (codePoint >> 18));
+        text.push_back(0x80 | ((codePoint >> 12) & 0x3f));
+        text.push_back(0x80 | ((codePoint >> 6) & 0x3f));
+        text.push_back(0x80 | (codePoint & 0x3f));
+    }
+
+    return text;
+}
+
+/* Returns the value of the attribute in the tag, or an empty string */
+static std::string attribute(const std::string & tag, const std::string & name)
+{
+    std::string lowerTag(tag);
+    std::transform(lowerTag.begin(), lowerTag.end(), lowerTag.begin(), ::tolower);
+
+    for (size_t position = lowerTag.find(name); position != std::string::npos;
+        position = lowerTag.find(name, position + 1))
+    {
+        size_t end = position + name.size();
+
+        if (position == 0 || !std::isspace(static_cast<unsigned char>(lowerTag[position - 1])))
+            continue;
+
+        while (end < tag.size() && std::isspace(static_cast<unsigned char>(tag[end])))
+            ++end;
+
+        if (end == tag.size() || tag[end] != '=')
+            continue;
+
+        do
+            ++end;
+        while (end < tag.size() && std::isspace(static_cast<unsigned char>(tag[end])));
+
+        std::string value;
+
+        if (end < tag.size() && (tag[end] == '"' || tag[end] == '\''))
+        {
+            size_t close = tag.find(tag[end], end + 1);
+            value = tag.substr(end + 1, close == std::string::npos ? close : close - end - 1);
+        }
+        else
+        {
+            size_t close = end;
+
+            while (close < tag.size() && !std::isspace(static_cast<unsigned char>(tag[close])))
+                ++close;
+
+            value = tag.substr(end, close - end);
+        }
+
+        /* URLs often contain &amp; */
+        for (size_t amp = 0; (amp = value.find("&amp;", amp)) != std::string::npos; ++amp)
+            value.replace(amp, 5, "&");
+
+        return value;
+    }
+
+    return std::string();
+}
+
+HtmlConverter::HtmlConverter(TextBuffer & lines)
+    : _lines(lines),
+        _state(Text),
+        _quote(0),
+        _lineStarted(false),
+        _lineHasText(false),
+        _space(false),
+        _breaks(0),
+        _quoteDepth(0),
+        _preDepth(0)
+{
+}
+
+void HtmlConverter::feed(const char * data, size_t length)
+{
+    for (const char * character = data, * e = data + length; character != e; ++character)
+        handleChar(*character);
+}
+
+void HtmlConverter::finish()
+{
+    if (_state == Entity)
+        addText("&" + _buffer);
+
+    endLine();
+
+    if (!_links.empty())
+    {
+        _lines.addLine(std::string());
+        _lines.addLine("References");
+        _lines.addLine(std::string());
+
+        for (size_t index = 0; index < _links.size(); ++index)
+        {
+            std::string number(std::to_string(index + 1) + ". ");
+            size_t padding = number.size() < 5 ? 5 - number.size() : 0;
+
+            _lines.addLine(std::string(padding, ' ') + number + _links[index]);
+        }
+    }
+
+    while (!_lines.empty() && _lines.back().empty())
+        _lines.removeLastLine();
+}
+
+void HtmlConverter::handleChar(char character)
+{
+    switch (_state)
+    {
+        case Text:
+            if (character == '<')
+            {
+                _state = Tag;
+                _buffer.clear();
+                _quote = 0;
+            }
+            else if (character == '&' && _skipping.empty())
+            {
+                _state = Entity;
+                _buffer.clear();
+            }
+            else if (_skipping.empty())
+                addChar(character);
+
+            break;
+
+        case Tag:
+            /* A lone < is just text */
+            if (_buffer.empty() && !std::isalpha(static_cast<unsigned char>(character))
+                && character != '/' && character != '!')
+            {
+                _state = Text;
+                addChar('<');
+                handleChar(character);
+                break;
+            }
+
+            if (_quote)
+            {
+                if (character == _quote)
+                    _quote = 0;
+            }
+            else if (character == '>')
+            {
+                _state = Text;
+                handleTag();
+                break;
+            }
+            else if ((character == '"' || character == '\'') && _buffer.find('=') != std::string::npos)
+                _quote = character;
+
+            if (_buffer.size() < maxTagLength)
+                _buffer.push_back(character);
+
+            if (_buffer == "!--")
+            {
+                _state = Comment;
+                _buffer.clear();
+            }
+
+            break;
+
+        case Comment:
+            if (character == '>' && _buffer == "--")
+                _state = Text;
+            else
+            {
+                _buffer.push_back(character);
+
+                if (_buffer.size() > 2)
+                    _buffer.erase(0, _buffer.size() - 2);
+            }
+
+            break;
+
+        case Entity:
+            if (character == ';')
+            {
+                _state = Text;
+                handleEntity();
+            }
+            else if ((std::isalnum(static_cast<unsigned char>(character)) || character == '#')
+                && _buffer.size() < maxEntityLength)
+            {
+                _buffer.push_back(character);
+            }
+            else
+            {
+                /* Not an entity after all */
+                _state = Text;
+                addText("&" + _buffer);
+                handleChar(character);
+            }
+
+            break;
+    }
+}
+
+void HtmlConverter::handleTag()
+{
+    bool closing = !_buffer.empty() && _buffer[0] == '/';
+    size_t nameEnd = _buffer.find_first_of(" \t\r\n/", closing ? 1 : 0);
+
+    std::string name(_buffer.substr(closing ? 1 : 0,
+        nameEnd == std::string::npos ? nameEnd : nameEnd - (closing ? 1 : 0)));
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    if (!_skipping.empty())
+    {
+        /* A missing </head> shouldn't hide the whole message */
+        if ((closing && name == _skipping) || (_skipping == "head" && name == "body"))
+            _skipping.clear();
+
+        return;
+    }
+
+    if (!closing && skippedTags.count(name))
+    {
+        _skipping = name;
+        return;
+    }
+
+    if (name == "br")
+    {
+        startLine();
+        endLine();
+        return;
+    }
+
+    if (paragraphTags.count(name))
+        breakLine(2);
+    else if (lineTags.count(name))
+        breakLine();
+
+    if (name == "blockquote")
+        _quoteDepth = std::max(_quoteDepth + (closing ? -1 : 1), 0);
+    else if (name == "pre")
+        _preDepth = std::max(_preDepth + (closing ? -1 : 1), 0);
+    else if (name == "ul" || name == "ol")
+    {
+        if (closing)
+        {
+            if (!_lists.empty())
+                _lists.pop_back();
+
+            if (_lists.empty())
+                breakLine(2);
+        }
+        else
+        {
+            if (_lists.empty())
+                breakLine(2);
+
+            _lists.push_back(name == "ol" ? 1 : -1);
+        }
+    }
+    else if (name == "li" && !closing)
+    {
+        if (_lists.empty())
+            _bullet = "* ";
+        else if (_lists.back() < 0)
+            _bullet = "* ";
+        else
+            _bullet = std::to_string(_lists.back()++) + ". ";
+    }
+    else if (name == "hr")
+    {
+        breakLine();
+        addText(std::string(horizontalRuleWidth, '-'));
+        breakLine();
+    }
+    else if (name == "td" || name == "th")
+        addSpace();
+    else if (name == "img" && !closing)
+    {
+        std::string alt(attribute(_buffer, "alt"));
+
+        if (!alt.empty())
+            addText("[" + alt + "]");
+    }
+    else if (name == "a")
+    {
+        if (!closing)
+            _href = attribute(_buffer, "href");
+        else if (!_href.empty())
+        {
+            /* Links within the message and scripts aren't worth listing */
+            if (_href[0] != '#' && _href.compare(0, 11, "javascript:") != 0)
+            {
+                _links.push_back(_href);
+                addText("[" + std::to_string(_links.size()) + "]");
+            }
+
+            _href.clear();
+        }
+    }
+}
+
+void HtmlConverter::handleEntity()
+{
+    if (!_buffer.empty() && _buffer[0] == '#')
+    {
+        bool hex = _buffer.size() > 1 && (_buffer[1] == 'x' || _buffer[1] == 'X');
+        unsigned long codePoint = std::strtoul(_buffer.c_str() + (hex ? 2 : 1), NULL,
+            hex ? 16 : 10);
+
+        /* Non-breaking spaces are just spaces here */
+        addText(codePoint == 0xa0 ? " " : encodeUtf8(codePoint));
+        return;
+    }
+
+    auto entity = namedEntities.find(_buffer);
+
+    if (entity != namedEntities.end())
+        addText(entity->second);
+    else
+        addText("&" + _buffer + ";");
+}
+
+void HtmlConverter::addChar(char character)
+{
+    if (character == '\r')
+        return;
+
+    if (_preDepth == 0)
+    {
+        if (std::isspace(static_cast<unsigned char>(character)))
+        {
+            addSpace();
+            return;
+        }
+    }
+    else if (character == '\n')
+    {
+        startLine();
+        endLine();
+        return;
+    }
+
+    startLine();
+
+    if (_space && _lineHasText)
+        _line.push_back(' ');
+
+    _space = false;
+
+    if (character == '\t')
+        _line.append(8 - _line.size() % 8, ' ');
+    else
+        _line.push_back(character);
+
+    _lineHasText = true;
+}
+
+void HtmlConverter::addText(const std::string & text)
+{
+    for (auto character = text.begin(), e = text.end(); character != e; ++character)
+    {
+        /* Text from entities is kept as it is, even outside of <pre> */
+        if (*character == ' ')
+        {
+            startLine();
+            _line.push_back(' ');
+        }
+        else
+            addChar(*character);
+    }
+}
+
+void HtmlConverter::addSpace()
+{
+    _space = true;
+}
+
+void HtmlConverter::breakLine(int lines)
+{
+    _breaks = std::max(_breaks, lines);
+}
+
+void HtmlConverter::startLine()
+{
+    if (_breaks > 0)
+    {
+        endLine();
+
+        if (_breaks > 1 && !_lines.empty() && !_lines.back().empty())
+            _lines.addLine(std::string());
+
+        _breaks = 0;
+    }
+
+    if (_lineStarted)
+        return;
+
+    _line.clear();
+
+    for (int depth = 0; depth < _quoteDepth; ++depth)
+        _line.append("> ");
+
+    int indent = 2 * _lists.size();
+
+    if (!_bullet.empty())
+    {
+        _line.append(std::max<int>(indent - 2, 0), ' ');
+        _line.append(_bullet);
+        _bullet.clear();
+    }
+    else
+        _line.append(indent, ' ');
+
+    _lineStarted = true;
+    _lineHasText = false;
+    _space = false;
+}
+
+void HtmlConverter::endLine()
+{
+    if (!_lineStarted)
+        return;
+
+    _lines.addLine(_line);
+    _line.clear();
+    _lineStarted = false;
+    _lineHasText = false;
+    _space = false;
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
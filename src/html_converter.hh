@@ -0,0 +1,109 @@
+/* ner: src/html_converter.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_HTML_CONVERTER_H
+#define NER_HTML_CONVERTER_H 1
+
+#include <string>
+#include <vector>
+
+#include "text_buffer.hh"
+
+/**
+ * Converts HTML to plain text lines, for the "builtin" html command.
+ *
+ * The HTML is converted in a single pass as it is fed in, so only the
+ * current tag or entity is buffered. Block elements start new lines,
+ * list items are bulleted or numbered, block quotes are quoted with "> ",
+ * and links are numbered and listed as references at the end.
+ *
+ * This is not a full HTML parser; it is meant for the kind of HTML found in
+ * email.
+ */
+class HtmlConverter
+{
+    public:
+        HtmlConverter(TextBuffer & lines);
+
+        void feed(const char * data, size_t length);
+
+        /**
+         * Finishes the last line, and appends the list of links.
+         */
+        void finish();
+
+    private:
+        enum State
+        {
+            Text,
+            Tag,
+            Comment,
+            Entity
+        };
+
+        void handleChar(char character);
+        void handleTag();
+        void handleEntity();
+
+        void addChar(char character);
+        void addText(const std::string & text);
+        void addSpace();
+
+        /**
+         * Makes sure the next text starts on a new line, with a blank line
+         * before it if lines is 2.
+         */
+        void breakLine(int lines = 1);
+
+        void startLine();
+        void endLine();
+
+        TextBuffer & _lines;
+
+        State _state;
+        std::string _buffer;
+
+        /* The quote around the tag attribute being read, if any */
+        char _quote;
+
+        /* The tag whose contents are being skipped, such as script */
+        std::string _skipping;
+
+        std::string _line;
+        bool _lineStarted;
+        bool _lineHasText;
+        bool _space;
+        int _breaks;
+
+        int _quoteDepth;
+        int _preDepth;
+
+        /* The number of the next item of each open list, or -1 for
+         * unordered lists */
+        std::vector<int> _lists;
+        std::string _bullet;
+
+        std::string _href;
+        std::vector<std::string> _links;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
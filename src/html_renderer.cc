@@ -0,0 +1,157 @@
+/* ner: src/html_renderer.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "html_renderer.hh"
+#include "ner_config.hh"
+#include "util.hh"
+
+/* How long the html command may take */
+const auto renderTimeout = std::chrono::seconds(10);
+
+std::string renderHtml(const std::string & html)
+{
+    std::string command(NerConfig::instance().command("html"));
+
+    /* The input is a socket rather than a pipe, so that it can be written
+     * with MSG_NOSIGNAL; writing after the command has exited then fails
+     * with EPIPE instead of raising SIGPIPE */
+    int input[2];
+    int output[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, input) == -1)
+        throw std::runtime_error("Could not run the html command");
+
+    if (pipe2(output, O_CLOEXEC) == -1)
+    {
+        close(input[0]);
+        close(input[1]);
+        throw std::runtime_error("Could not run the html command");
+    }
+
+    pid_t pid = spawnCommand(command, input[1], output[1]);
+
+    close(input[1]);
+    close(output[1]);
+
+    int inputFd = input[0];
+    int outputFd = output[0];
+
+    if (pid == -1)
+    {
+        close(inputFd);
+        close(outputFd);
+        throw std::runtime_error("Could not run the html command");
+    }
+
+    fcntl(inputFd, F_SETFL, O_NONBLOCK);
+    fcntl(outputFd, F_SETFL, O_NONBLOCK);
+
+    auto deadline = std::chrono::steady_clock::now() + renderTimeout;
+    std::string text;
+    size_t written = 0;
+    bool timedOut = false;
+
+    if (html.empty())
+    {
+        close(inputFd);
+        inputFd = -1;
+    }
+
+    while (outputFd != -1)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+
+        if (remaining.count() <= 0)
+        {
+            timedOut = true;
+            kill(pid, SIGKILL);
+            break;
+        }
+
+        pollfd fds[] = {
+            { outputFd, POLLIN, 0 },
+            { inputFd, POLLOUT, 0 }
+        };
+
+        /* A negative descriptor is ignored by poll */
+        if (poll(fds, 2, remaining.count()) == -1 && errno != EINTR)
+            break;
+
+        if (fds[1].revents)
+        {
+            ssize_t length = send(inputFd, html.data() + written, html.size() - written,
+                MSG_NOSIGNAL);
+
+            if (length > 0)
+                written += length;
+
+            /* Once everything is written (or the command stops reading), the
+             * command sees the end of its input */
+            if (written == html.size() || (length == -1 && errno != EAGAIN && errno != EINTR))
+            {
+                close(inputFd);
+                inputFd = -1;
+            }
+        }
+
+        if (fds[0].revents)
+        {
+            char buffer[4096];
+            ssize_t length = read(outputFd, buffer, sizeof buffer);
+
+            if (length > 0)
+                text.append(buffer, length);
+            else if (length == 0 || (errno != EAGAIN && errno != EINTR))
+            {
+                close(outputFd);
+                outputFd = -1;
+            }
+        }
+    }
+
+    if (inputFd != -1)
+        close(inputFd);
+
+    if (outputFd != -1)
+        close(outputFd);
+
+    int status = waitForProcess(pid);
+
+    if (timedOut)
+        throw std::runtime_error("The html command timed out");
+
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw std::runtime_error("The html command failed");
+
+    return text;
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
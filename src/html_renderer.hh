@@ -0,0 +1,43 @@
+/* ner: src/html_renderer.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_HTML_RENDERER_H
+#define NER_HTML_RENDERER_H 1
+
+#include <string>
+
+/**
+ * Renders HTML as text with the configured html command.
+ *
+ * The HTML is written to the command while its output is read, so neither
+ * side can block on a full pipe. The command is killed if it runs for too
+ * long.
+ *
+ * This blocks until the command is done, so it should be run on the
+ * WorkerPool.
+ *
+ * \return The rendered text.
+ * \throws std::runtime_error If the command fails or times out.
+ */
+std::string renderHtml(const std::string & html);
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -19,41 +19,40 @@
 
 #include "line_wrapper.hh"
 
-LineWrapper::LineWrapper(const std::string & string, int width)
-    : _start(string.begin()), _position(string.begin()), _end(string.end()),
+LineWrapper::LineWrapper(const TextBuffer::Line & line, int width)
+    : _start(line.begin()), _position(line.begin()), _end(line.end()),
         _width(width), _done(false)
 {
 }
 
-std::string LineWrapper::next()
+TextBuffer::Line LineWrapper::next()
 {
-    std::string line;
+    const char * lineStart = _position;
+    const char * lineEnd;
 
     if (_position + _width < _end)
     {
         auto notSpace = std::bind(std::logical_not<bool>(),
             std::bind(std::equal_to<char>(), ' ', std::placeholders::_1));
 
-        auto lineEnd = std::find_if(std::find(
-            std::string::const_reverse_iterator(_position + _width + 1),
-            std::string::const_reverse_iterator(_position), ' '),
-            std::string::const_reverse_iterator(_position), notSpace).base();
+        lineEnd = std::find_if(std::find(
+            std::reverse_iterator<const char *>(_position + _width + 1),
+            std::reverse_iterator<const char *>(_position), ' '),
+            std::reverse_iterator<const char *>(_position), notSpace).base();
 
         if (lineEnd == _position && (lineEnd = std::find(_position + _width, _end, ' ')) == _end)
             _done = true;
 
-        line = std::string(_position, lineEnd);
-
         _position = std::find_if(lineEnd, _end, notSpace);
     }
     else
     {
-        line = std::string(_position, _end);
+        lineEnd = _end;
         _position = _end;
         _done = true;
     }
 
-    return line;
+    return TextBuffer::Line(lineStart, lineEnd);
 }
 
 bool LineWrapper::done() const
@@ -24,19 +24,21 @@
 #include <algorithm>
 #include <functional>
 
+#include "text_buffer.hh"
+
 class LineWrapper
 {
     public:
-        explicit LineWrapper(const std::string & string, int width = 80);
+        explicit LineWrapper(const TextBuffer::Line & line, int width = 80);
 
-        std::string next();
+        TextBuffer::Line next();
         bool done() const;
         bool wrapped() const;
 
     private:
-        std::string::const_iterator _start;
-        std::string::const_iterator _position;
-        std::string::const_iterator _end;
+        const char * _start;
+        const char * _position;
+        const char * _end;
         int _width;
         bool _done;
 };
@@ -21,7 +21,6 @@
 #include <iostream>
 #include <fstream>
 #include <clocale>
-#include <csignal>
 #include <unistd.h>
 #include <gmime/gmime.h>
 
@@ -34,26 +33,6 @@
 
 const std::string notmuchConfigFile(".notmuch-config");
 
-void resize(int arg)
-{
-    endwin();
-    refresh();
-
-    ViewManager::instance().resize();
-    StatusBar::instance().resize();
-
-    refresh();
-
-    ViewManager::instance().update();
-    StatusBar::instance().update();
-
-    ViewManager::instance().refresh();
-    StatusBar::instance().refresh();
-
-    /* Clear the -1 character */
-    getch();
-}
-
 void initialize()
 {
     /* Initialize the screen */
@@ -99,17 +78,11 @@ int main(int argc, char * argv[])
 
     initialize();
 
-    std::signal(SIGWINCH, &resize);
-
     try
     {
         NotMuch::setConfig(configPath);
         NerConfig::instance().load();
 
-        if (NerConfig::instance().refreshView())
-            /* Refresh the view every minute (or when the user presses a key). */
-            timeout(60000);
-
         Ner ner;
 
         std::shared_ptr<View> searchListView(new SearchListView());
@@ -0,0 +1,231 @@
+/* ner: src/message_cache.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "message_cache.hh"
+#include "worker_pool.hh"
+#include "ner_config.hh"
+#include "util.hh"
+
+static std::string recipients(GMimeMessage * message, GMimeRecipientType type)
+{
+    char * addresses = internet_address_list_to_string(
+        g_mime_message_get_recipients(message, type), true);
+    std::string result(addresses ? : "(null)");
+    g_free(addresses);
+
+    return result;
+}
+
+MessageCache & MessageCache::instance()
+{
+    static MessageCache * cache = NULL;
+    static std::once_flag created;
+
+    /* Messages are prefetched on other threads */
+    std::call_once(created, [] { cache = new MessageCache(); });
+
+    return *cache;
+}
+
+MessageCache::MessageCache()
+    : _size(0)
+{
+}
+
+std::shared_ptr<const ParsedMessage> MessageCache::message(const std::string & filename)
+{
+    std::string fileKey(key(filename));
+
+    if (fileKey.empty())
+        return std::shared_ptr<const ParsedMessage>();
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _parsed.wait(lock, [&] { return _parsing.find(fileKey) == _parsing.end(); });
+
+        std::shared_ptr<const ParsedMessage> message(find(fileKey));
+
+        if (message)
+            return message;
+
+        _parsing.insert(fileKey);
+    }
+
+    /* Let anybody waiting for the file know when we are done with it */
+    auto done = onScopeEnd([&] {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _parsing.erase(fileKey);
+        }
+
+        _parsed.notify_all();
+    });
+
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+        return std::shared_ptr<const ParsedMessage>();
+
+    std::shared_ptr<const ParsedMessage> message(parse(fd));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _entries.push_front(Entry(fileKey, message));
+    _index[fileKey] = _entries.begin();
+    _size += message->size;
+
+    shrink(NerConfig::instance().messageCacheSize());
+
+    return message;
+}
+
+std::shared_ptr<const ParsedMessage> MessageCache::prepare(const std::string & filename)
+{
+    std::shared_ptr<const ParsedMessage> parsed(message(filename));
+
+    if (!parsed)
+        return parsed;
+
+    for (auto part = parsed->parts.begin(), e = parsed->parts.end(); part != e; ++part)
+    {
+        if (const TextPart * text = dynamic_cast<const TextPart *>(part->get()))
+        {
+            /* HTML rendered by a command is only started here */
+            text->lines();
+            break;
+        }
+    }
+
+    return parsed;
+}
+
+void MessageCache::prefetch(const std::string & filename,
+    const std::shared_ptr<std::atomic<bool>> & cancelled)
+{
+    std::string fileKey(key(filename));
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (fileKey.empty() || _index.find(fileKey) != _index.end()
+            || _parsing.find(fileKey) != _parsing.end())
+        {
+            return;
+        }
+    }
+
+    WorkerPool::instance().post([this, filename, cancelled] {
+        if (!*cancelled)
+            prepare(filename);
+    });
+}
+
+std::shared_ptr<const ParsedMessage> MessageCache::parse(int fd)
+{
+    std::shared_ptr<ParsedMessage> message(new ParsedMessage());
+
+    /* Read the whole file up front, so that attachments don't keep it open */
+    GMimeStream * fileStream = g_mime_stream_fs_new(fd);
+    GMimeStream * stream = g_mime_stream_mem_new();
+    g_mime_stream_write_to_stream(fileStream, stream);
+    g_mime_stream_reset(stream);
+    g_object_unref(fileStream);
+
+    message->size = g_mime_stream_length(stream);
+
+    GMimeParser * parser = g_mime_parser_new_with_stream(stream);
+    GMimeMessage * mimeMessage = g_mime_parser_construct_message(parser);
+    g_object_unref(parser);
+    g_object_unref(stream);
+
+    if (!mimeMessage)
+        return message;
+
+    /* Read relavant headers */
+    message->headers = {
+        { "To",         recipients(mimeMessage, GMIME_RECIPIENT_TYPE_TO) },
+        { "From",       g_mime_message_get_sender(mimeMessage) ? : "(null)" },
+        { "Cc",         recipients(mimeMessage, GMIME_RECIPIENT_TYPE_CC) },
+        { "Bcc",        recipients(mimeMessage, GMIME_RECIPIENT_TYPE_BCC) },
+        { "Subject",    g_mime_message_get_subject(mimeMessage) ? : "(null)" }
+    };
+
+    /* Locate plain text parts */
+    processMimePart(g_mime_message_get_mime_part(mimeMessage),
+        std::back_inserter(message->parts));
+
+    g_object_unref(mimeMessage);
+
+    /* Text parts are only decoded once they are shown, so allow for about as
+     * much again as the raw message for the decoded text */
+    message->size *= 2;
+
+    for (auto header = message->headers.begin(), e = message->headers.end();
+        header != e; ++header)
+    {
+        message->size += header->first.size() + header->second.size();
+    }
+
+    return message;
+}
+
+std::string MessageCache::key(const std::string & filename)
+{
+    struct stat info;
+
+    if (stat(filename.c_str(), &info) == -1)
+        return std::string();
+
+    std::ostringstream key;
+    key << filename << '\0' << info.st_size << '\0'
+        << info.st_mtim.tv_sec << '.' << info.st_mtim.tv_nsec;
+
+    return key.str();
+}
+
+std::shared_ptr<const ParsedMessage> MessageCache::find(const std::string & key)
+{
+    auto entry = _index.find(key);
+
+    if (entry == _index.end())
+        return std::shared_ptr<const ParsedMessage>();
+
+    _entries.splice(_entries.begin(), _entries, entry->second);
+
+    return entry->second->second;
+}
+
+void MessageCache::shrink(size_t capacity)
+{
+    while (_size > capacity && !_entries.empty())
+    {
+        _size -= _entries.back().second->size;
+        _index.erase(_entries.back().first);
+        _entries.pop_back();
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -0,0 +1,125 @@
+/* ner: src/message_cache.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_MESSAGE_CACHE_H
+#define NER_MESSAGE_CACHE_H 1
+
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "message_part.hh"
+
+/* A message file, parsed into the parts we display */
+struct ParsedMessage
+{
+    std::map<std::string, std::string> headers;
+    std::vector<std::shared_ptr<MessagePart>> parts;
+
+    /* An estimate of the memory used by the message, in bytes */
+    size_t size;
+};
+
+/**
+ * Keeps recently parsed messages around, so that revisiting a message does
+ * not mean parsing and decoding it again.
+ *
+ * Messages are keyed by their filename, size and modification time, and the
+ * least recently used ones are dropped once the cache grows beyond the
+ * message_cache_size setting.
+ *
+ * This class is a singleton. It may be used from any thread, so that
+ * messages can be parsed ahead of time on the WorkerPool.
+ */
+class MessageCache
+{
+    public:
+        static MessageCache & instance();
+
+        /**
+         * Returns the parsed message file, parsing it if it is not cached.
+         *
+         * If the file is being parsed by another thread, waits for it
+         * rather than parsing it again.
+         *
+         * \return The message, or a null pointer if the file cannot be read.
+         */
+        std::shared_ptr<const ParsedMessage> message(const std::string & filename);
+
+        /**
+         * Like message(), but also decodes the first text part, which is
+         * the one shown when the message is opened.
+         *
+         * This is meant for background threads, so that showing the message
+         * later doesn't decode anything on the UI thread.
+         */
+        std::shared_ptr<const ParsedMessage> prepare(const std::string & filename);
+
+        /**
+         * Parses the message file and decodes its first text part on the
+         * WorkerPool, unless it is cached.
+         *
+         * \param cancelled If it is set by the time the job starts, the file
+         *                  is not parsed.
+         */
+        void prefetch(const std::string & filename,
+            const std::shared_ptr<std::atomic<bool>> & cancelled);
+
+    private:
+        typedef std::pair<std::string, std::shared_ptr<const ParsedMessage>> Entry;
+
+        MessageCache();
+
+        static std::shared_ptr<const ParsedMessage> parse(int fd);
+
+        /**
+         * Returns the cache key for the file, which changes whenever the file
+         * is rewritten, or an empty string if the file does not exist.
+         */
+        static std::string key(const std::string & filename);
+
+        /* Returns the cached message, or a null pointer. Requires _mutex. */
+        std::shared_ptr<const ParsedMessage> find(const std::string & key);
+
+        void shrink(size_t capacity);
+
+        std::mutex _mutex;
+        std::condition_variable _parsed;
+
+        /* The keys of the files being parsed */
+        std::set<std::string> _parsing;
+
+        /* The most recently used entries are at the front */
+        std::list<Entry> _entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+
+        size_t _size;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -17,109 +17,223 @@
  * ner.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include "message_part.hh"
+#include "html_renderer.hh"
+#include "html_converter.hh"
 #include "ner_config.hh"
-#include "gmime_iostream.hh"
+#include "render_cache.hh"
+#include "transfer_decoder.hh"
+#include "charset_converter.hh"
 #include "message_part_visitor.hh"
+#include "worker_pool.hh"
+#include "view_manager.hh"
+
+/* How much of a part is converted to UTF-8 at a time */
+const size_t convertBlockSize = 64 * 1024;
+
+/* Converts blocks of a text part's content to UTF-8 lines, converting HTML
+ * with HtmlConverter */
+class TextConverter
+{
+    public:
+        TextConverter(const char * charset, bool html, size_t size)
+            : _lines(std::make_shared<TextBuffer>()),
+                _htmlConverter(html ? new HtmlConverter(*_lines) : 0),
+                _charsetConverter(charset)
+        {
+            /* The converted text is usually about as large as the content */
+            if (!_htmlConverter)
+                _lines->reserve(size);
+        }
+
+        void feed(const char * data, size_t length)
+        {
+            /* Convert the content in slices, so the converted copy stays
+             * small */
+            for (size_t position = 0; position < length; position += convertBlockSize)
+            {
+                _charsetConverter.convert(data + position,
+                    std::min(convertBlockSize, length - position), _text);
+                output();
+            }
+        }
+
+        std::shared_ptr<TextBuffer> finish()
+        {
+            _charsetConverter.finish(_text);
+            output();
+
+            if (_htmlConverter)
+                _htmlConverter->finish();
+
+            return _lines;
+        }
+
+    private:
+        void output()
+        {
+            if (_htmlConverter)
+                _htmlConverter->feed(_text.data(), _text.size());
+            else
+                _lines->append(_text.data(), _text.size());
+
+            _text.clear();
+        }
 
-#include <sys/types.h>
-#include <sys/wait.h>
+        std::shared_ptr<TextBuffer> _lines;
+        std::unique_ptr<HtmlConverter> _htmlConverter;
+        CharsetConverter _charsetConverter;
+        std::string _text;
+};
 
 MessagePart::MessagePart(const std::string & id_)
-    : id(id_), folded(true)
+    : id(id_)
 {
 }
 
 TextPart::TextPart(GMimePart * part)
-    : MessagePart(g_mime_part_get_content_id(part) ? : std::string())
+    : MessagePart(g_mime_part_get_content_id(part) ? : std::string()),
+        contentType(g_mime_content_type_to_string(
+            g_mime_object_get_content_type(GMIME_OBJECT(part)))),
+        _part(part),
+        _rendering(false)
 {
-    GMimeContentType * mimeContentType = g_mime_object_get_content_type(GMIME_OBJECT(part));
-    contentType = g_mime_content_type_to_string(mimeContentType);
+    g_object_ref(_part);
+}
 
-    GMimeStream * contentStream = NULL;
+TextPart::~TextPart()
+{
+    g_object_unref(_part);
+}
 
-    /* If this part is html text */
-    if (g_mime_content_type_is_type(mimeContentType, "text", "html"))
-    {
-        int readPipes[2];
-        int writePipes[2];
+std::shared_ptr<const TextBuffer> TextPart::lines(bool wait) const
+{
+    static std::shared_ptr<const TextBuffer> renderingLines;
+    static std::once_flag renderingLinesCreated;
 
-        pipe(readPipes);
-        pipe(writePipes);
+    std::call_once(renderingLinesCreated, [] {
+        std::shared_ptr<TextBuffer> lines(std::make_shared<TextBuffer>());
+        lines->addLine("[Rendering HTML...]");
+        renderingLines = lines;
+    });
 
-        GMimeDataWrapper * content = g_mime_part_get_content_object(part);
+    std::unique_lock<std::mutex> lock(_mutex);
 
-        if (pid_t pid = fork())
+    if (!_lines)
+    {
+        if (!isHtml())
+            decode();
+        else if (!_rendering)
+            convert();
+
+        if (!_lines)
         {
-            close(writePipes[0]);
-            close(readPipes[1]);
+            if (!wait)
+                return renderingLines;
 
-            GMimeStream * pipeStream = g_mime_stream_fs_new(writePipes[1]);
-            g_mime_data_wrapper_write_to_stream(content, pipeStream);
-            close(writePipes[1]);
+            _decoded.wait(lock, [this] { return bool(_lines); });
+        }
+    }
 
-            contentStream = g_mime_stream_fs_new(readPipes[0]);
-            g_mime_stream_fs_set_owner(GMIME_STREAM_FS(contentStream), true);
+    return _lines;
+}
 
-            int status;
-            waitpid(pid, &status, 0);
-        }
-        else
-        {
-            close(readPipes[0]);
-            close(writePipes[1]);
+bool TextPart::isHtml() const
+{
+    return g_mime_content_type_is_type(
+        g_mime_object_get_content_type(GMIME_OBJECT(_part)), "text", "html");
+}
 
-            dup2(readPipes[1], 1);
-            dup2(writePipes[0], 0);
+const char * TextPart::charset() const
+{
+    return g_mime_object_get_content_type_parameter(GMIME_OBJECT(_part), "charset");
+}
 
-            execlp("sh", "sh", "-c", NerConfig::instance().command("html").c_str(), NULL);
-            exit(0);
-        }
-    }
-    /* If this part is text */
-    else if (g_mime_content_type_is_type(mimeContentType, "text", "*"))
+void TextPart::decode() const
+{
+    GMimeDataWrapper * data = g_mime_part_get_content_object(_part);
+    gint64 size = g_mime_stream_length(g_mime_data_wrapper_get_stream(data));
+
+    /* The content goes straight from the stream through the decoders, so
+     * it is never copied whole */
+    TextConverter converter(charset(), isHtml(), std::max<gint64>(size, 0));
+
+    readDecodedContent(data, [&](const char * block, size_t length) {
+        converter.feed(block, length);
+    });
+
+    _lines = converter.finish();
+}
+
+void TextPart::convert() const
+{
+    std::string command(NerConfig::instance().command("html"));
+    std::string html(content());
+
+    /* The builtin converter works on the HTML converted to UTF-8, while
+     * other commands are given it as it is */
+    std::string key(RenderCache::key(command,
+        command == "builtin" && charset() ? charset() : std::string(), html));
+
+    if ((_lines = RenderCache::instance().find(key)))
+        return;
+
+    /* The builtin converter is quick enough to use straight away */
+    if (command == "builtin")
     {
-        GMimeDataWrapper * content = g_mime_part_get_content_object(part);
-        const char * charset = g_mime_object_get_content_type_parameter(GMIME_OBJECT(part), "charset");
-        GMimeStream * stream = g_mime_data_wrapper_get_stream(content);
+        TextConverter converter(charset(), true, html.size());
+        converter.feed(html.data(), html.size());
+
+        _lines = converter.finish();
+        RenderCache::instance().store(key, *_lines);
+    }
+    else
+        render(html, key);
+}
 
-        GMimeStream * filteredStream = g_mime_stream_filter_new(stream);
+void TextPart::render(const std::string & html, const std::string & key) const
+{
+    _rendering = true;
 
-        GMimeFilter * filter = g_mime_filter_basic_new(g_mime_data_wrapper_get_encoding(content), false);
-        g_mime_stream_filter_add(GMIME_STREAM_FILTER(filteredStream), filter);
-        g_object_unref(filter);
+    std::shared_ptr<const TextPart> part(shared_from_this());
 
-        if (charset)
+    WorkerPool::instance().post([part, html, key] {
+        std::shared_ptr<TextBuffer> lines(std::make_shared<TextBuffer>());
+
+        try
         {
-            GMimeFilter * filter = g_mime_filter_charset_new(charset, "UTF-8");
-            g_mime_stream_filter_add(GMIME_STREAM_FILTER(filteredStream), filter);
-            g_object_unref(filter);
+            std::string text(renderHtml(html));
+            lines->reserve(text.size());
+            lines->append(text.data(), text.size());
+
+            RenderCache::instance().store(key, *lines);
+        }
+        catch (const std::runtime_error & e)
+        {
+            lines->addLine(std::string("[") + e.what() + "]");
         }
 
-        g_mime_stream_reset(stream);
+        {
+            std::lock_guard<std::mutex> lock(part->_mutex);
+            part->_lines = lines;
+        }
 
-        contentStream = filteredStream;
-    }
-    else
-    {
-        /* We don't know how to handle this part */
-    }
+        part->_decoded.notify_all();
+    }, [] { ViewManager::instance().requestUpdate(); });
+}
 
-    if (contentStream == NULL)
-        throw std::runtime_error(std::string("Cannot handle content type: ") +
-            contentType);
+std::string TextPart::content() const
+{
+    std::string content;
 
-    GMimeIOStream stream(contentStream);
-    g_object_unref(contentStream);
+    readDecodedContent(g_mime_part_get_content_object(_part),
+        [&](const char * block, size_t length) {
+            content.append(block, length);
+        });
 
-    while (stream.good())
-    {
-        std::string line;
-        std::getline(stream, line);
-        for (std::size_t tab = 0; (tab = line.find('\t', tab)) != std::string::npos; ++tab)
-            line.replace(tab, 1, 8 - (tab % 8), ' ');
-        lines.push_back(line);
-    }
+    return content;
 }
 
 void TextPart::accept(MessagePartVisitor & visitor)
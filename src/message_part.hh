@@ -22,10 +22,14 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <gmime/gmime.h>
 
 #include "ncurses.hh"
 #include "view.hh"
+#include "text_buffer.hh"
 
 class MessagePartVisitor;
 
@@ -35,18 +39,64 @@ struct MessagePart
 
     virtual void accept(MessagePartVisitor & visitor) = 0;
 
-    bool folded;
     std::string id;
 };
 
-struct TextPart : public MessagePart
+/**
+ * A text part, which is only decoded once its lines are first needed.
+ *
+ * HTML parts are rendered by the html command on the WorkerPool, and a
+ * placeholder is shown in the meantime. With the "builtin" html command,
+ * they are converted straight away instead.
+ */
+struct TextPart : public MessagePart, public std::enable_shared_from_this<TextPart>
 {
     TextPart(GMimePart * part);
+    TextPart(const TextPart &) = delete;
+    ~TextPart();
 
     virtual void accept(MessagePartVisitor & visitor);
 
-    std::vector<std::string> lines;
+    /**
+     * Returns the decoded lines of the part, decoding it if necessary.
+     *
+     * This may be called from any thread.
+     *
+     * \param wait Whether to wait for an HTML part to be rendered, rather
+     *             than returning a placeholder.
+     */
+    std::shared_ptr<const TextBuffer> lines(bool wait = false) const;
+
     std::string contentType;
+
+    private:
+        bool isHtml() const;
+
+        /* Returns the charset parameter of the part, or 0 */
+        const char * charset() const;
+
+        /* Decodes the part as it is read, converting HTML with
+         * HtmlConverter, requires _mutex */
+        void decode() const;
+
+        /**
+         * Looks for an HTML part in the RenderCache, and otherwise converts
+         * it, or starts rendering it. Requires _mutex.
+         */
+        void convert() const;
+
+        /* Starts rendering an HTML part, requires _mutex */
+        void render(const std::string & html, const std::string & key) const;
+
+        /* Returns the content of the part, without any transfer encoding */
+        std::string content() const;
+
+        GMimePart * _part;
+
+        mutable std::mutex _mutex;
+        mutable std::condition_variable _decoded;
+        mutable bool _rendering;
+        mutable std::shared_ptr<const TextBuffer> _lines;
 };
 
 struct Attachment : public MessagePart
@@ -28,14 +28,17 @@
 const int wrapWidth(80);
 
 MessagePartDisplayVisitor::MessagePartDisplayVisitor(WINDOW * window,
-    const View::Geometry & area, int offset, int selection)
+    const View::Geometry & area, int offset, int selection,
+    const std::set<const MessagePart *> & unfoldedParts)
     : _window(window), _area(area), _offset(offset), _row(area.y), _messageRow(0),
-        _selection(selection)
+        _selection(selection), _unfoldedParts(unfoldedParts)
 {
 }
 
 void MessagePartDisplayVisitor::visit(const TextPart & part)
 {
+    bool folded = _unfoldedParts.find(&part) == _unfoldedParts.end();
+
     if (_messageRow >= _offset && _row < _area.y + _area.height)
     {
         bool selected = _messageRow == _selection;
@@ -44,7 +47,7 @@ void MessagePartDisplayVisitor::visit(const TextPart & part)
         wmove(_window, _row++, _area.x);
 
         attr_t attributes = 0;
-        x += NCurses::addChar(_window, part.folded ? '+' : '-',
+        x += NCurses::addChar(_window, folded ? '+' : '-',
                               A_BOLD | attributes, ColorID::AttachmentFilename);
         NCurses::checkMove(_window, ++x);
 
@@ -62,13 +65,17 @@ void MessagePartDisplayVisitor::visit(const TextPart & part)
         NCurses::checkMove(_window, x - 1);
         ++_messageRow;
     }
-    if (part.folded)
+    if (folded)
         return;
 
-    for (auto line = part.lines.begin(), e = part.lines.end(); line != e; ++line)
+    std::shared_ptr<const TextBuffer> lines(part.lines());
+
+    for (size_t index = 0; index < lines->size(); ++index)
     {
+        TextBuffer::Line line((*lines)[index]);
+
         unsigned citationLevel = 0;
-        for (auto character = line->begin(); character != line->end(); ++character)
+        for (auto character = line.begin(); character != line.end(); ++character)
         {
             if (*character == '>')
                 ++citationLevel;
@@ -88,13 +95,14 @@ void MessagePartDisplayVisitor::visit(const TextPart & part)
             }
         }
 
-        for (auto lineWrapper = LineWrapper(*line, _area.width-1); !lineWrapper.done(); ++_messageRow)
+        for (auto lineWrapper = LineWrapper(line, _area.width-1); !lineWrapper.done(); ++_messageRow)
         {
             bool selected = _messageRow == _selection;
             bool wrapped = lineWrapper.wrapped();
 
-            std::string wrappedLine(lineWrapper.next());
+            TextBuffer::Line wrappedLine(lineWrapper.next());
 
+            /* Only lines which are drawn are copied */
             if (_messageRow < _offset || _row >= _area.y + _area.height)
                 continue;
 
@@ -111,7 +119,7 @@ void MessagePartDisplayVisitor::visit(const TextPart & part)
                 wchgat(_window, _area.width - 2, A_REVERSE, 0, NULL);
             }
 
-            if (NCurses::addUtf8String(_window, wrappedLine.c_str(), attributes, color) >
+            if (NCurses::addUtf8String(_window, wrappedLine.str().c_str(), attributes, color) >
                 _area.width - _area.y - 2)
             {
                 NCurses::addCutOffIndicator(_window, attributes);
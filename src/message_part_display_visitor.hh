@@ -20,15 +20,24 @@
 #ifndef NER_MESSAGE_PART_DISPLAY_VISITOR_H
 #define NER_MESSAGE_PART_DISPLAY_VISITOR_H 1
 
+#include <set>
+
 #include "message_part_visitor.hh"
 #include "ncurses.hh"
 #include "view.hh"
 
+struct MessagePart;
+
 class MessagePartDisplayVisitor : public MessagePartVisitor
 {
     public:
+        /**
+         * \param unfoldedParts The parts whose text is displayed. Parts are
+         *                      shared between views, so each view keeps
+         *                      track of its own folding.
+         */
         MessagePartDisplayVisitor(WINDOW * window, const View::Geometry & area,
-            int offset, int selection);
+            int offset, int selection, const std::set<const MessagePart *> & unfoldedParts);
 
         virtual void visit(const TextPart & part);
         virtual void visit(const Attachment & part);
@@ -43,6 +52,7 @@ class MessagePartDisplayVisitor : public MessagePartVisitor
         int _messageRow;
         int _offset;
         int _selection;
+        const std::set<const MessagePart *> & _unfoldedParts;
 };
 
 #endif
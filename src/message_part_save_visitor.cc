@@ -19,6 +19,7 @@
 
 #include "message_part_save_visitor.hh"
 #include "message_part.hh"
+#include "transfer_decoder.hh"
 #include "status_bar.hh"
 #include "line_editor.hh"
 
@@ -53,7 +54,7 @@ void MessagePartSaveVisitor::visit(const Attachment & part)
 
         FILE * file = fopen(filename.c_str(), "w");
         GMimeStream * stream = g_mime_stream_file_new(file);
-        g_mime_data_wrapper_write_to_stream(part.data, stream);
+        writeDecodedContent(part.data, stream);
         g_object_unref(stream);
     }
     catch (AbortInputException&)
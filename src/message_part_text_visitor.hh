@@ -20,7 +20,10 @@
 #ifndef NER_MESSAGE_PART_TEXT_VISITOR_H
 #define NER_MESSAGE_PART_TEXT_VISITOR_H 1
 
+#include <memory>
+
 #include "message_part_visitor.hh"
+#include "message_part.hh"
 
 template <class OutputIterator>
     class MessagePartTextVisitor : public MessagePartVisitor
@@ -33,7 +36,10 @@ template <class OutputIterator>
 
         virtual void visit(const TextPart & part)
         {
-            _iterator = std::copy(part.lines.begin(), part.lines.end(), _iterator);
+            std::shared_ptr<const TextBuffer> lines(part.lines(true));
+
+            for (size_t index = 0; index < lines->size(); ++index)
+                *_iterator++ = (*lines)[index].str();
         }
 
         virtual void visit(const Attachment & part)
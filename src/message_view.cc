@@ -22,6 +22,7 @@
 
 #include "message_view.hh"
 #include "notmuch.hh"
+#include "database_pool.hh"
 #include "colors.hh"
 #include "ncurses.hh"
 #include "status_bar.hh"
@@ -37,20 +38,21 @@ MessageView::~MessageView()
 
 void MessageView::setMessage(const std::string & messageId)
 {
-    notmuch_database_t * database = NotMuch::openDatabase();
-    notmuch_message_t * message;
+    std::string filename;
 
-    notmuch_database_find_message(database, messageId.c_str(), &message);
-
-    if (!message)
     {
-        notmuch_database_close(database);
-        throw NotMuch::InvalidMessageException(messageId);
-    }
+        NotMuch::Database database;
+        notmuch_message_t * message;
+
+        notmuch_database_find_message(database, messageId.c_str(), &message);
 
-    std::string filename = notmuch_message_get_filename(message);
+        if (!message)
+            throw NotMuch::InvalidMessageException(messageId);
 
-    notmuch_database_close(database);
+        filename = notmuch_message_get_filename(message);
+
+        notmuch_message_destroy(message);
+    }
 
     setEmail(filename);
 }
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <sys/types.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include "ner.hh"
 #include "ncurses.h"
@@ -34,6 +35,10 @@
 #include "colors.hh"
 #include "notmuch.hh"
 #include "line_editor.hh"
+#include "ner_config.hh"
+
+/* How often to refresh the view, which also keeps relative times current */
+const auto refreshViewInterval = std::chrono::milliseconds(60000);
 
 Ner::Ner()
 {
@@ -45,7 +50,7 @@ Ner::Ner()
     addHandledSequence("T",     std::bind(&Ner::openThread, this));
     addHandledSequence(";",     std::bind(&Ner::openViewView, this));
     addHandledSequence("<C-l>", std::bind(&Ner::redraw, this));
-    addHandledSequence("<C-z>", std::bind(&kill, getpid(), SIGTSTP));
+    addHandledSequence("<C-z>", std::bind(&Ner::suspend, this));
 }
 
 Ner::~Ner()
@@ -54,54 +59,30 @@ Ner::~Ner()
 
 void Ner::run()
 {
-    std::vector<int> sequence;
-
     _running = true;
 
     _viewManager.refresh();
 
-    while (_running)
-    {
-        int key = getch();
-
-        if (key == KEY_BACKSPACE && sequence.size() > 0)
-            sequence.pop_back();
-        else if (key == 'c' - 96) // Ctrl-C
-            sequence.clear();
-        else
-        {
-            sequence.push_back(key);
-
-            auto handleResult = handleKeySequence(sequence);
-
-            /* If Ner handled the input sequence */
-            if (handleResult == InputHandler::HandleResult::Handled)
-                sequence.clear();
-            else
-            {
-                auto viewManagerHandleResult = _viewManager.handleKeySequence(sequence);
-
-                /* If the ViewManager handled the input sequence, or neither
-                 * Ner nor the ViewManager had a partial match with the input
-                 * sequence */
-                if (viewManagerHandleResult == InputHandler::HandleResult::Handled ||
-                    (viewManagerHandleResult == InputHandler::HandleResult::NoMatch &&
-                        handleResult == InputHandler::HandleResult::NoMatch))
-                    sequence.clear();
-            }
-        }
+    _eventLoop.watch(STDIN_FILENO, std::bind(&Ner::handleInput, this));
+    _eventLoop.handleSignal(SIGWINCH, std::bind(&Ner::resize, this));
+    _eventLoop.handleSignal(SIGTSTP, std::bind(&Ner::suspend, this));
 
-        if (!_running)
-            break;
+    /* Refresh at the start of each minute, when relative times change */
+    if (NerConfig::instance().refreshView())
+    {
+        auto untilNextMinute = std::chrono::milliseconds((60 - time(0) % 60) * 1000);
 
-        _viewManager.update();
-        _viewManager.refresh();
+        _eventLoop.addPeriodicTimer(untilNextMinute, refreshViewInterval,
+            std::bind(&Ner::refreshView, this));
     }
+
+    _eventLoop.run();
 }
 
 void Ner::quit()
 {
     _running = false;
+    _eventLoop.quit();
 }
 
 void Ner::search()
@@ -180,5 +161,98 @@ void Ner::redraw()
     _statusBar.refresh();
 }
 
+void Ner::resize()
+{
+    endwin();
+    refresh();
+
+    _viewManager.resize();
+    _statusBar.resize();
+
+    refresh();
+
+    _viewManager.update();
+    _statusBar.update();
+
+    _viewManager.refresh();
+    _statusBar.refresh();
+}
+
+void Ner::suspend()
+{
+    endwin();
+
+    /* SIGTSTP is blocked, so stop ourselves the hard way */
+    kill(getpid(), SIGSTOP);
+
+    /* Continued, so draw everything again */
+    redraw();
+
+    _viewManager.update();
+    _viewManager.refresh();
+}
+
+void Ner::handleInput()
+{
+    while (_running)
+    {
+        /* Only read the keys which are already available, but let the
+         * handlers block on input (for prompts) */
+        timeout(0);
+        int key = getch();
+        timeout(-1);
+
+        if (key == ERR)
+            break;
+
+        handleKey(key);
+    }
+
+    if (_running)
+    {
+        _viewManager.update();
+        _viewManager.refresh();
+    }
+}
+
+void Ner::handleKey(int key)
+{
+    if (key == KEY_BACKSPACE && _sequence.size() > 0)
+        _sequence.pop_back();
+    else if (key == 'c' - 96) // Ctrl-C
+        _sequence.clear();
+    else
+    {
+        _sequence.push_back(key);
+
+        auto handleResult = handleKeySequence(_sequence);
+
+        /* If Ner handled the input sequence */
+        if (handleResult == InputHandler::HandleResult::Handled)
+            _sequence.clear();
+        else
+        {
+            auto viewManagerHandleResult = _viewManager.handleKeySequence(_sequence);
+
+            /* If the ViewManager handled the input sequence, or neither
+             * Ner nor the ViewManager had a partial match with the input
+             * sequence */
+            if (viewManagerHandleResult == InputHandler::HandleResult::Handled ||
+                (viewManagerHandleResult == InputHandler::HandleResult::NoMatch &&
+                    handleResult == InputHandler::HandleResult::NoMatch))
+                _sequence.clear();
+        }
+    }
+}
+
+void Ner::refreshView()
+{
+    /* In case inotify missed anything */
+    _databaseWatcher.check();
+
+    _viewManager.update();
+    _viewManager.refresh();
+}
+
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
 
@@ -26,6 +26,9 @@
 #include "input_handler.hh"
 #include "view_manager.hh"
 #include "status_bar.hh"
+#include "event_loop.hh"
+#include "worker_pool.hh"
+#include "database_watcher.hh"
 
 class Ner : public InputHandler
 {
@@ -42,6 +45,8 @@ class Ner : public InputHandler
         void openThread();
         void openViewView();
         void redraw();
+        void resize();
+        void suspend();
 
         inline ViewManager & viewManager()
         {
@@ -49,8 +54,18 @@ class Ner : public InputHandler
         }
 
     private:
+        void handleInput();
+        void handleKey(int key);
+        void refreshView();
+
         bool _running;
+        std::vector<int> _sequence;
+
+        /* Declared first so that they outlive the views using them */
+        EventLoop _eventLoop;
+        WorkerPool _workerPool;
         ViewManager _viewManager;
+        DatabaseWatcher _databaseWatcher;
         StatusBar _statusBar;
 };
 
@@ -76,6 +76,9 @@ void NerConfig::load()
     _sortMode = NOTMUCH_SORT_NEWEST_FIRST;
     _refreshView = true;
     _addSigDashes = true;
+    _messageCacheSize = 32;
+    _prefetchDepth = 1;
+    _renderCacheSize = 64;
     _commands.clear();
 
     std::map<ColorID, Color> colorMap = defaultColorMap;
@@ -128,6 +131,21 @@ void NerConfig::load()
 
             if (addSigDashesNode)
                 *addSigDashesNode >> _addSigDashes;
+
+            auto messageCacheSizeNode = general->FindValue("message_cache_size");
+
+            if (messageCacheSizeNode)
+                *messageCacheSizeNode >> _messageCacheSize;
+
+            auto prefetchDepthNode = general->FindValue("prefetch_depth");
+
+            if (prefetchDepthNode)
+                *prefetchDepthNode >> _prefetchDepth;
+
+            auto renderCacheSizeNode = general->FindValue("render_cache_size");
+
+            if (renderCacheSizeNode)
+                *renderCacheSizeNode >> _renderCacheSize;
         }
 
         /* Commands */
@@ -222,6 +240,10 @@ std::string NerConfig::command(const std::string & name)
             return "/usr/sbin/sendmail -t";
         else if (name == "edit")
             return "vim +";
+        else if (name == "html")
+            return "builtin";
+        else
+            return std::string();
     }
     else
     {
@@ -249,5 +271,22 @@ bool NerConfig::addSigDashes() const
     return _addSigDashes;
 }
 
+size_t NerConfig::messageCacheSize() const
+{
+    /* The setting is in megabytes */
+    return _messageCacheSize << 20;
+}
+
+int NerConfig::prefetchDepth() const
+{
+    return _prefetchDepth;
+}
+
+size_t NerConfig::renderCacheSize() const
+{
+    /* The setting is in megabytes */
+    return _renderCacheSize << 20;
+}
+
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
 
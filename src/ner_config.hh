@@ -43,6 +43,22 @@ class NerConfig
 
         bool addSigDashes() const;
 
+        /**
+         * The memory budget for parsed messages, in bytes.
+         */
+        size_t messageCacheSize() const;
+
+        /**
+         * How many messages on either side of the selected one in a thread
+         * are parsed ahead of time.
+         */
+        int prefetchDepth() const;
+
+        /**
+         * The size limit of the on-disk cache of rendered HTML, in bytes.
+         */
+        size_t renderCacheSize() const;
+
     private:
         NerConfig();
         ~NerConfig();
@@ -52,6 +68,9 @@ class NerConfig
         notmuch_sort_t _sortMode;
         bool _refreshView;
         bool _addSigDashes;
+        size_t _messageCacheSize;
+        int _prefetchDepth;
+        size_t _renderCacheSize;
 };
 
 #endif
@@ -0,0 +1,198 @@
+/* ner: src/render_cache.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <tuple>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <glib.h>
+
+#include "render_cache.hh"
+#include "ner_config.hh"
+#include "util.hh"
+
+const std::string renderCacheDirectory("rendered");
+
+RenderCache & RenderCache::instance()
+{
+    static RenderCache * cache = NULL;
+    static std::once_flag created;
+
+    /* Parts may be rendered on several threads at once */
+    std::call_once(created, [] { cache = new RenderCache(); });
+
+    return *cache;
+}
+
+RenderCache::RenderCache()
+    : _path(cacheDirectory() + "/" + renderCacheDirectory),
+        _size(-1)
+{
+    mkdir(_path.c_str(), 0700);
+}
+
+std::string RenderCache::key(const std::string & command, const std::string & charset,
+    const std::string & html)
+{
+    GChecksum * checksum = g_checksum_new(G_CHECKSUM_SHA1);
+
+    g_checksum_update(checksum, reinterpret_cast<const guchar *>(command.c_str()),
+        command.size() + 1);
+    g_checksum_update(checksum, reinterpret_cast<const guchar *>(charset.c_str()),
+        charset.size() + 1);
+    g_checksum_update(checksum, reinterpret_cast<const guchar *>(html.data()), html.size());
+
+    std::string key(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+
+    return key;
+}
+
+std::shared_ptr<const TextBuffer> RenderCache::find(const std::string & key)
+{
+    int fd = open((_path + "/" + key).c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+        return std::shared_ptr<const TextBuffer>();
+
+    std::shared_ptr<TextBuffer> lines(std::make_shared<TextBuffer>());
+    struct stat info;
+
+    if (fstat(fd, &info) == 0)
+        lines->reserve(info.st_size);
+
+    char buffer[65536];
+    ssize_t length;
+
+    while ((length = read(fd, buffer, sizeof buffer)) != 0)
+    {
+        if (length == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            close(fd);
+            return std::shared_ptr<const TextBuffer>();
+        }
+
+        lines->append(buffer, length);
+    }
+
+    /* The modification time records when the file was last used */
+    futimens(fd, NULL);
+    close(fd);
+
+    return lines;
+}
+
+void RenderCache::store(const std::string & key, const TextBuffer & lines)
+{
+    std::string temporaryPath(_path + "/." + key + "-XXXXXX");
+    int fd = mkstemp(&temporaryPath[0]);
+
+    if (fd == -1)
+        return;
+
+    std::string text;
+
+    for (size_t index = 0; index < lines.size(); ++index)
+    {
+        if (index > 0)
+            text.push_back('\n');
+
+        TextBuffer::Line line(lines[index]);
+        text.append(line.begin(), line.end());
+    }
+
+    bool written = true;
+
+    for (size_t offset = 0; offset < text.size() && written; )
+    {
+        ssize_t length = write(fd, text.data() + offset, text.size() - offset);
+
+        if (length > 0)
+            offset += length;
+        else
+            written = false;
+    }
+
+    close(fd);
+
+    /* Readers only ever see complete files */
+    if (!written || rename(temporaryPath.c_str(), (_path + "/" + key).c_str()) == -1)
+    {
+        unlink(temporaryPath.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_size >= 0)
+        _size += text.size();
+
+    shrink(NerConfig::instance().renderCacheSize());
+}
+
+void RenderCache::shrink(size_t capacity)
+{
+    if (_size >= 0 && size_t(_size) <= capacity)
+        return;
+
+    DIR * directory = opendir(_path.c_str());
+
+    if (!directory)
+        return;
+
+    std::vector<std::tuple<time_t, off_t, std::string>> files;
+    _size = 0;
+
+    while (dirent * entry = readdir(directory))
+    {
+        std::string path(_path + "/" + entry->d_name);
+        struct stat info;
+
+        if (entry->d_name[0] == '.' || stat(path.c_str(), &info) == -1)
+            continue;
+
+        files.push_back(std::make_tuple(info.st_mtime, info.st_size, path));
+        _size += info.st_size;
+    }
+
+    closedir(directory);
+
+    if (size_t(_size) <= capacity)
+        return;
+
+    std::sort(files.begin(), files.end());
+
+    /* Leave some room, so we don't have to do this again straight away */
+    for (auto file = files.begin(), e = files.end();
+        file != e && size_t(_size) > capacity * 3 / 4; ++file)
+    {
+        if (unlink(std::get<2>(*file).c_str()) == 0)
+            _size -= std::get<1>(*file);
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
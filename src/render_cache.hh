@@ -0,0 +1,81 @@
+/* ner: src/render_cache.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_RENDER_CACHE_H
+#define NER_RENDER_CACHE_H 1
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "text_buffer.hh"
+
+/**
+ * An on-disk cache of rendered HTML parts, kept across sessions.
+ *
+ * Each rendered part is stored as a plain text file. Files are named by a
+ * hash of the HTML and the way it was rendered, so the same part is found
+ * again whichever message or reply it comes from. Once the cache is larger
+ * than the render_cache_size setting, the least recently used files are
+ * removed.
+ *
+ * This class is a singleton, and may be used from any thread.
+ */
+class RenderCache
+{
+    public:
+        static RenderCache & instance();
+
+        /**
+         * Returns the key for HTML rendered with the given command.
+         *
+         * \param charset The charset of the HTML, if it is converted before
+         *                rendering.
+         */
+        static std::string key(const std::string & command, const std::string & charset,
+            const std::string & html);
+
+        /**
+         * Returns the rendered lines for the key, or a null pointer if they
+         * aren't cached.
+         */
+        std::shared_ptr<const TextBuffer> find(const std::string & key);
+
+        void store(const std::string & key, const TextBuffer & lines);
+
+    private:
+        RenderCache();
+
+        /* Removes the least recently used files until the cache fits in the
+         * given size. Requires _mutex. */
+        void shrink(size_t capacity);
+
+        std::string _path;
+
+        std::mutex _mutex;
+
+        /* The total size of the cached files, or -1 if not known yet */
+        long _size;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
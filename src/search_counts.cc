@@ -0,0 +1,148 @@
+/* ner: src/search_counts.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "search_counts.hh"
+#include "database_pool.hh"
+#include "worker_pool.hh"
+#include "util.hh"
+
+const std::string searchCountsFile("search-counts");
+
+SearchCounts::SearchCounts()
+    : _path(cacheDirectory() + "/" + searchCountsFile),
+        _dirty(false)
+{
+    load();
+}
+
+SearchCounts::~SearchCounts()
+{
+    save();
+}
+
+bool SearchCounts::find(const std::string & query, Count & count) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto entry = _counts.find(query);
+
+    if (entry == _counts.end())
+        return false;
+
+    count = entry->second;
+
+    return true;
+}
+
+void SearchCounts::refresh(const std::string & query, const std::function<void ()> & done)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_pending.insert(query).second)
+            return;
+    }
+
+    WorkerPool::instance().post(std::bind(&SearchCounts::count, shared_from_this(), query), done);
+}
+
+void SearchCounts::save()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_dirty)
+        return;
+
+    std::ofstream file(_path.c_str());
+
+    for (auto entry = _counts.begin(), e = _counts.end(); entry != e; ++entry)
+    {
+        const Count & count = entry->second;
+
+        file << count.revision << ' ' << (count.uuid.empty() ? "-" : count.uuid) << ' '
+            << count.total << ' ' << count.unread << ' ' << entry->first << std::endl;
+    }
+
+    _dirty = false;
+}
+
+void SearchCounts::load()
+{
+    std::ifstream file(_path.c_str());
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string query;
+        Count count;
+
+        if (fields >> count.revision >> count.uuid >> count.total >> count.unread &&
+            fields.get() == ' ' && std::getline(fields, query))
+        {
+            _counts[query] = count;
+        }
+    }
+}
+
+void SearchCounts::count(const std::string & query)
+{
+    auto finished = onScopeEnd([&] {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.erase(query);
+    });
+
+    NotMuch::Database database;
+    Count count;
+
+    count.revision = database.revision(&count.uuid);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto entry = _counts.find(query);
+
+        /* Nothing has changed since we last counted */
+        if (entry != _counts.end() && entry->second.revision == count.revision &&
+            entry->second.uuid == count.uuid)
+        {
+            return;
+        }
+    }
+
+    /* Count the totals and unread messages with the same handle, so that they
+     * agree with each other */
+    notmuch_query_t * totalQuery = notmuch_query_create(database, query.c_str());
+    count.total = notmuch_query_count_messages(totalQuery);
+    notmuch_query_destroy(totalQuery);
+
+    notmuch_query_t * unreadQuery = notmuch_query_create(database,
+        ("(" + query + ") and tag:unread").c_str());
+    count.unread = notmuch_query_count_messages(unreadQuery);
+    notmuch_query_destroy(unreadQuery);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _counts[query] = count;
+    _dirty = true;
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
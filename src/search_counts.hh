@@ -0,0 +1,87 @@
+/* ner: src/search_counts.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_SEARCH_COUNTS_H
+#define NER_SEARCH_COUNTS_H 1
+
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+/**
+ * A cache of message counts for saved searches.
+ *
+ * Counts are computed in the background by the WorkerPool and remembered
+ * along with the database revision they were computed at, so they are only
+ * recomputed after the database changes. The last known counts are saved
+ * across sessions.
+ */
+class SearchCounts : public std::enable_shared_from_this<SearchCounts>
+{
+    public:
+        struct Count
+        {
+            unsigned total;
+            unsigned unread;
+            unsigned long revision;
+            std::string uuid;
+        };
+
+        SearchCounts();
+        ~SearchCounts();
+
+        /**
+         * Looks up the last known count for a query.
+         *
+         * \param query The search terms.
+         * \param count Set to the count, if there is one.
+         * \return Whether there was a count for the query.
+         */
+        bool find(const std::string & query, Count & count) const;
+
+        /**
+         * Recounts the given query in the background, unless a recount is
+         * already in progress.
+         *
+         * \param done If set, called on the UI thread once the count is done.
+         */
+        void refresh(const std::string & query,
+            const std::function<void ()> & done = std::function<void ()>());
+
+        void save();
+
+    private:
+        void load();
+        void count(const std::string & query);
+
+        std::string _path;
+
+        mutable std::mutex _mutex;
+        std::map<std::string, Count> _counts;
+        std::set<std::string> _pending;
+        bool _dirty;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
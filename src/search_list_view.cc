@@ -24,14 +24,18 @@
 #include "search_view.hh"
 #include "ncurses.hh"
 #include "ner_config.hh"
+#include "search_counts.hh"
 
 const int searchNameWidth = 15;
 const int searchTermsWidth = 30;
 
 SearchListView::SearchListView(const View::Geometry & geometry)
     : LineBrowserView(geometry),
-        _searches(NerConfig::instance().searches())
+        _searches(NerConfig::instance().searches()),
+        _counts(std::make_shared<SearchCounts>())
 {
+    refreshCounts();
+
     /* Key Sequences */
     addHandledSequence("\n", std::bind(&SearchListView::openSelectedSearch, this));
 }
@@ -82,11 +86,13 @@ void SearchListView::update()
 
             /* Number of Results */
             std::ostringstream results;
-            notmuch_database_t * database = NotMuch::openDatabase();
-            notmuch_query_t * query = notmuch_query_create(database, search->query.c_str());
-            results << notmuch_query_count_messages(query) << " results";
-            notmuch_query_destroy(query);
-            notmuch_database_close(database);
+            SearchCounts::Count count;
+
+            /* Until the first count comes in, there is nothing to show */
+            if (_counts->find(search->query, count))
+                results << count.total << " results (" << count.unread << " unread)";
+            else
+                results << "counting...";
 
             NCurses::addPlainString(_window, results.str(), attributes,
                 ColorID::SearchListViewResults);
@@ -118,6 +124,13 @@ int SearchListView::lineCount() const
     return _searches.size();
 }
 
+void SearchListView::refreshCounts()
+{
+    for (auto search = _searches.begin(), e = _searches.end(); search != e; ++search)
+        _counts->refresh(search->query,
+            std::bind(&ViewManager::requestUpdate, &ViewManager::instance()));
+}
+
 void SearchListView::openSelectedSearch()
 {
     ViewManager::instance().addView(std::make_shared<SearchView>(
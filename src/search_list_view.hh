@@ -21,9 +21,12 @@
 #define NER_SEARCH_LIST_VIEW_H 1
 
 #include <vector>
+#include <memory>
 
 #include "line_browser_view.hh"
 
+class SearchCounts;
+
 struct Search
 {
     std::string name;
@@ -39,14 +42,21 @@ class SearchListView : public LineBrowserView
         virtual void update();
         virtual std::string name() const { return "search-list-view"; }
         virtual std::vector<std::string> status() const;
+        virtual void databaseChanged() { refreshCounts(); }
 
         void openSelectedSearch();
 
+        /**
+         * Recounts the results of each search in the background.
+         */
+        void refreshCounts();
+
     protected:
         virtual int lineCount() const;
 
     private:
         std::vector<Search> _searches;
+        std::shared_ptr<SearchCounts> _counts;
 };
 
 #endif
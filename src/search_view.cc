@@ -22,7 +22,7 @@
 #include <algorithm>
 #include <chrono>
 #include <iterator>
-#include <sched.h>
+#include <unordered_set>
 
 #include "search_view.hh"
 #include "thread_message_view.hh"
@@ -31,55 +31,108 @@
 #include "colors.hh"
 #include "ncurses.hh"
 #include "notmuch.hh"
+#include "database_pool.hh"
 #include "status_bar.hh"
+#include "event_loop.hh"
 
 const int newestDateWidth = 13;
 const int messageCountWidth = 8;
 const int authorsWidth = 20;
 
-const auto conditionWaitTime = std::chrono::milliseconds(50);
+/* The maximum number of threads kept in memory per search */
+const int threadWindowSize = 512;
+
+/* If more threads than this have changed, don't bother reusing any */
+const int maxChangedThreads = 2000;
+
+/* The number of threads to fetch per query */
+const int threadBatchSize = 64;
+
+/* Collected threads are handed to the UI at least this often */
+const auto publishInterval = std::chrono::milliseconds(100);
+
+/* How often to update the progress while collecting */
+const auto progressInterval = std::chrono::milliseconds(1000);
+
+/* How long the selection must stay on a thread before it is preloaded */
+const auto preloadDelay = std::chrono::milliseconds(300);
+
+/* The number of preloaded threads to keep around */
+const int maxPreloadedThreads = 2;
 
 SearchView::SearchView(const std::string & search, const View::Geometry & geometry)
     : LineBrowserView(geometry),
-        _searchTerms(search)
+        _searchTerms(search),
+        _cancelled(false),
+        _publishedAll(false),
+        _publishedCount(-1),
+        _collecting(false),
+        _collectedCount(0),
+        _progressTimer(0),
+        _replacing(false),
+        _pendingSelectionIndex(0),
+        _threadCount(-1),
+        _windowStart(0),
+        _preloadTimer(0),
+        _revision(0)
 {
-    _collecting = true;
-    _thread = std::thread(std::bind(&SearchView::collectThreads, this));
+    collectWindow(0);
 
     /* Key Sequences */
     addHandledSequence("=", std::bind(&SearchView::refreshThreads, this));
     addHandledSequence("\n", std::bind(&SearchView::openSelectedThread, this));
-
-    std::unique_lock<std::mutex> lock(_mutex);
-    while (_threads.size() < getmaxy(_window) && _collecting)
-        _condition.wait_for(lock, conditionWaitTime);
 }
 
 SearchView::~SearchView()
 {
-    if (_thread.joinable())
-    {
-        _collecting = false;
-        _thread.join();
-    }
+    stopCollecting();
+
+    if (_progressTimer)
+        EventLoop::instance().cancelTimer(_progressTimer);
+
+    if (_preloadTimer)
+        EventLoop::instance().cancelTimer(_preloadTimer);
 }
 
 void SearchView::update()
 {
-    werase(_window);
+    destroyRetired();
 
-    if (_offset > _threads.size())
-        return;
+    /* Show our progress while collecting */
+    if (takeThreads() || _collecting)
+    {
+        StatusBar::instance().update();
+        StatusBar::instance().refresh();
+    }
+
+    /* Keep the elapsed time up to date, even if no threads arrive */
+    if (_collecting && !_progressTimer)
+    {
+        _progressTimer = EventLoop::instance().addTimer(progressInterval, [this] {
+            _progressTimer = 0;
+            ViewManager::instance().requestUpdate();
+        });
+    }
+
+    /* If we scrolled out of the current window, collect a new one around the
+     * visible threads */
+    if (!windowCovers(_offset, _offset + visibleLines()))
+        collectWindow(std::max(0, _offset - (threadWindowSize - visibleLines()) / 2));
+
+    schedulePreload();
 
-    int row = 0;
+    werase(_window);
 
-    for (auto thread = _threads.begin() + _offset;
-        thread != _threads.end() && row < getmaxy(_window);
-        ++thread, ++row)
+    for (int row = std::max(0, _windowStart - _offset); row < getmaxy(_window); ++row)
     {
+        int index = row + _offset - _windowStart;
+
+        if (index >= _threads.size())
+            break;
+
         bool selected = row + _offset == _selectedIndex;
-        bool unread = thread->tags.find("unread") != thread->tags.end();
-        bool completeMatch = thread->matchedMessages == thread->totalMessages;
+        bool unread = _threads.hasTag(index, NotMuch::TagDictionary::unread);
+        bool completeMatch = _threads.matchedMessages(index) == _threads.totalMessages(index);
 
         int x = 0;
 
@@ -98,14 +151,14 @@ void SearchView::update()
         try
         {
             /* Date */
-            NCurses::addPlainString(_window, relativeTime(thread->newestDate),
+            NCurses::addPlainString(_window, relativeTime(_threads.newestDate(index)),
                 attributes, ColorID::SearchViewDate, newestDateWidth - 1);
 
             NCurses::checkMove(_window, x += newestDateWidth);
 
             /* Message Count */
             std::ostringstream messageCountStream;
-            messageCountStream << thread->matchedMessages << '/' << thread->totalMessages;
+            messageCountStream << _threads.matchedMessages(index) << '/' << _threads.totalMessages(index);
 
             x += NCurses::addChar(_window, '[', attributes);
             NCurses::checkMove(_window, x);
@@ -121,20 +174,21 @@ void SearchView::update()
             NCurses::checkMove(_window, x = newestDateWidth + messageCountWidth);
 
             /* Authors */
-            NCurses::addUtf8String(_window, thread->authors.c_str(),
+            NCurses::addUtf8String(_window, _threads.authors(index),
                 attributes, ColorID::SearchViewAuthors, authorsWidth - 1);
 
             NCurses::checkMove(_window, x += authorsWidth);
 
             /* Subject */
-            x += NCurses::addUtf8String(_window, thread->subject.c_str(),
+            x += NCurses::addUtf8String(_window, _threads.subject(index),
                 attributes, ColorID::SearchViewSubject);
 
             NCurses::checkMove(_window, ++x);
 
             /* Tags */
+            std::vector<std::string> tagNames(_threads.tagNames(index));
             std::ostringstream tagStream;
-            std::copy(thread->tags.begin(), thread->tags.end(),
+            std::copy(tagNames.begin(), tagNames.end(),
                 std::ostream_iterator<std::string>(tagStream, " "));
             std::string tags(tagStream.str());
 
@@ -157,27 +211,73 @@ std::vector<std::string> SearchView::status() const
 {
     std::ostringstream threadPosition;
 
-    if (_threads.size() > 0)
-        threadPosition << "thread " << (_selectedIndex + 1) << " of " << _threads.size();
+    if (lineCount() > 0)
+    {
+        threadPosition << "thread " << (_selectedIndex + 1) << " of ";
+
+        /* While collecting, the total is either from an earlier count, or
+         * just what we have so far */
+        if (_collecting && _threadCount >= 0)
+            threadPosition << '~' << lineCount();
+        else if (_collecting)
+            threadPosition << lineCount() << '+';
+        else
+            threadPosition << lineCount();
+    }
+    else if (_collecting)
+        threadPosition << "searching";
     else
         threadPosition << "no matching threads";
 
-    return std::vector<std::string>{
+    std::vector<std::string> status{
         "search-terms: \"" + _searchTerms + '"',
         threadPosition.str()
     };
+
+    if (_collecting)
+    {
+        int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - _collectStart).count();
+
+        std::ostringstream progress;
+        progress << "collected " << _collectedCount << " threads in "
+            << elapsed / 1000 << '.' << elapsed / 100 % 10 << 's';
+
+        status.push_back(progress.str());
+    }
+
+    return status;
 }
 
 void SearchView::openSelectedThread()
 {
-    std::lock_guard<std::mutex> lock(_mutex);
+    int index = _selectedIndex - _windowStart;
 
-    if (_selectedIndex < _threads.size())
+    if (index >= 0 && index < _threads.size())
     {
         try
         {
-            ViewManager::instance().addView(std::make_shared<ThreadMessageView>(
-                _threads.at(_selectedIndex).id));
+            std::string id(_threads.id(index));
+            std::shared_ptr<ThreadMessageView> view;
+
+            for (auto preloaded = _preloaded.begin(), e = _preloaded.end();
+                preloaded != e; ++preloaded)
+            {
+                if (preloaded->first == id)
+                {
+                    view = preloaded->second;
+                    _preloaded.erase(preloaded);
+
+                    /* The screen may have been resized since it was created */
+                    view->resize();
+                    break;
+                }
+            }
+
+            if (!view)
+                view = std::make_shared<ThreadMessageView>(id, _searchTerms);
+
+            ViewManager::instance().addView(view);
         }
         catch (const NotMuch::InvalidThreadException & e)
         {
@@ -190,108 +290,386 @@ void SearchView::openSelectedThread()
     }
 }
 
+void SearchView::databaseChanged()
+{
+    /* The preloaded threads may be out of date */
+    retirePreloaded(_preloaded.size());
+    _preloadId.clear();
+
+    refreshThreads();
+}
+
 void SearchView::refreshThreads()
+{
+    std::string selectedId;
+    int index = _selectedIndex - _windowStart;
+
+    if (index >= 0 && index < _threads.size())
+        selectedId = _threads.id(index);
+
+    _pendingSelection = selectedId;
+    _pendingSelectionIndex = _selectedIndex;
+
+    collectWindow(_windowStart);
+}
+
+void SearchView::schedulePreload()
+{
+    int index = _selectedIndex - _windowStart;
+    std::string id;
+
+    if (index >= 0 && index < _threads.size())
+        id = _threads.id(index);
+
+    if (id == _preloadId)
+        return;
+
+    /* The selection moved before the previous thread was preloaded */
+    if (_preloadTimer)
+    {
+        EventLoop::instance().cancelTimer(_preloadTimer);
+        _preloadTimer = 0;
+    }
+
+    _preloadId = id;
+
+    if (id.empty())
+        return;
+
+    for (auto preloaded = _preloaded.begin(), e = _preloaded.end(); preloaded != e; ++preloaded)
+    {
+        if (preloaded->first == id)
+            return;
+    }
+
+    _preloadTimer = EventLoop::instance().addTimer(preloadDelay, [this] {
+        _preloadTimer = 0;
+        preloadThread();
+    });
+}
+
+void SearchView::preloadThread()
+{
+    _preloaded.push_back(std::make_pair(_preloadId,
+        std::make_shared<ThreadMessageView>(_preloadId, _searchTerms)));
+
+    if (_preloaded.size() > maxPreloadedThreads)
+        retirePreloaded(_preloaded.size() - maxPreloadedThreads);
+}
+
+void SearchView::retirePreloaded(size_t count)
+{
+    for (; count > 0 && !_preloaded.empty(); --count)
+    {
+        _preloaded.front().second->cancelLoading();
+        _retired.push_back(_preloaded.front().second);
+        _preloaded.pop_front();
+    }
+
+    destroyRetired();
+}
+
+void SearchView::destroyRetired()
+{
+    _retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+        [](const std::shared_ptr<ThreadMessageView> & view) { return view->loaderFinished(); }),
+        _retired.end());
+}
+
+int SearchView::lineCount() const
+{
+    if (_threadCount >= 0)
+        return _threadCount;
+    else
+        return _windowStart + _threads.size();
+}
+
+void SearchView::collectWindow(int start)
+{
+    stopCollecting();
+
+    /* Give the collector a copy of the current window to reuse */
+    _reusable = _threads;
+    _reusableIndices = _threadIndices;
+
+    _replacing = start == _windowStart;
+
+    if (!_replacing)
+    {
+        _threads.clear();
+        _threadIndices.clear();
+    }
+
+    _threads.reserve(threadWindowSize);
+    _windowStart = start;
+
+    _published.clear();
+    _publishedAll = false;
+    _publishedCount = -1;
+
+    /* Start collecting threads in the background */
+    _collecting = true;
+    _collectStart = std::chrono::steady_clock::now();
+    _collectedCount = 0;
+    _thread = std::thread(std::bind(&SearchView::collectThreads, this, start,
+        _threadCount >= 0));
+}
+
+void SearchView::stopCollecting()
 {
     /* If the thread is still going, stop it, and wait for it to return */
     if (_thread.joinable())
     {
-        _collecting = false;
+        _cancelled = true;
         _thread.join();
+        _cancelled = false;
     }
 
-    bool empty = _threads.empty();
-    std::string selectedId;
+    _collecting = false;
+}
+
+bool SearchView::windowCovers(int first, int last) const
+{
+    int windowEnd = _windowStart + (_collecting ? threadWindowSize : _threads.size());
 
-    if (!empty)
-        selectedId = (*(_threads.begin() + _selectedIndex)).id;
+    /* Past the last thread, there is nothing to collect */
+    if (_threadCount >= 0)
+        last = std::min(last, _threadCount);
 
-    _threads.clear();
+    return first >= _windowStart && last <= windowEnd;
+}
 
-    /* Start collecting threads in the background */
-    _collecting = true;
-    _thread = std::thread(std::bind(&SearchView::collectThreads, this));
+bool SearchView::takeThreads()
+{
+    std::vector<NotMuch::ThreadTable> batches;
+    bool finished;
+    int threadCount;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
 
-    /* Locate the previously selected thread ID */
-    bool found = false;
-    std::unique_lock<std::mutex> lock(_mutex);
+        batches.swap(_published);
+        finished = _publishedAll;
+        threadCount = _publishedCount;
+    }
 
-    if (empty)
-        found = true;
-    else
+    if (!_collecting || (batches.empty() && !finished))
+        return false;
+
+    /* Replace the threads from before the refresh */
+    if (_replacing)
+    {
+        _threads.clear();
+        _threadIndices.clear();
+        _replacing = false;
+    }
+
+    for (auto batch = batches.begin(), e = batches.end(); batch != e; ++batch)
+    {
+        for (int index = 0; index < batch->size(); ++index)
+            _threadIndices[batch->id(index)] = _threads.append(*batch, index);
+
+        _collectedCount += batch->size();
+    }
+
+    /* Keep the previously selected thread selected, unless the selection has
+     * been moved in the meantime */
+    if (!_pendingSelection.empty())
     {
-        int index = 0;
+        auto index = _threadIndices.find(_pendingSelection);
 
-        while (!found && _collecting)
+        if (_selectedIndex != _pendingSelectionIndex)
+            _pendingSelection.clear();
+        else if (index != _threadIndices.end())
         {
-            for (; index < _threads.size(); ++index)
-            {
-                /* Stop if we found the thread ID */
-                if (_threads.at(index).id == selectedId)
-                {
-                    found = true;
-                    _selectedIndex = index;
-                    break;
-                }
-            }
+            _selectedIndex = _windowStart + index->second;
+            _pendingSelection.clear();
+            makeSelectionVisible();
+        }
+    }
 
-            _condition.wait_for(lock, conditionWaitTime);
+    if (finished)
+    {
+        _collecting = false;
+        _pendingSelection.clear();
+
+        if (threadCount >= 0)
+            _threadCount = threadCount;
+
+        /* Make sure the selected index is still valid */
+        if (_selectedIndex >= lineCount())
+        {
+            _selectedIndex = std::max(lineCount() - 1, 0);
+            makeSelectionVisible();
         }
     }
 
-    /* Wait until we have enough threads to fill the screen */
-    while (_threads.size() - _offset < getmaxy(_window) && _collecting)
-        _condition.wait_for(lock, conditionWaitTime);
+    return true;
+}
+
+void SearchView::collectThreads(int start, bool counted)
+{
+    NotMuch::Database database;
+    std::string uuid;
+    unsigned long revision = database.revision(&uuid);
+    bool changed = uuid != _uuid || revision != _revision;
+
+    /* Threads which changed since we last collected can't be reused, and
+     * revisions from a different database can't be compared */
+    if (uuid != _uuid || (revision != _revision && !dropChangedThreads(database, revision)))
+        _reusableIndices.clear();
 
-    /* If we didn't find it, make sure the selected index is valid */
-    if (!found)
+    _revision = revision;
+    _uuid = uuid;
+
+    /* Walk through the matching messages in order, to find the threads in
+     * the window without having to build the threads before it */
+    notmuch_query_t * query = notmuch_query_create(database, _searchTerms.c_str());
+    notmuch_query_set_sort(query, NerConfig::instance().sortMode());
+    notmuch_messages_t * messages;
+
+    std::unordered_set<std::string> seenIds;
+    std::vector<std::string> windowIds;
+    NotMuch::ThreadTable batch;
+    auto lastPublished = std::chrono::steady_clock::now();
+    int index = 0;
+
+    for (messages = notmuch_query_search_messages(query);
+        notmuch_messages_valid(messages) && !_cancelled && index < start + threadWindowSize;
+        notmuch_messages_move_to_next(messages))
     {
-        if (_threads.size() <= _selectedIndex)
-            _selectedIndex = _threads.size() - 1;
+        notmuch_message_t * message = notmuch_messages_get(messages);
+        std::string threadId(notmuch_message_get_thread_id(message));
+        notmuch_message_destroy(message);
+
+        if (seenIds.insert(threadId).second && index++ >= start)
+        {
+            windowIds.push_back(threadId);
+
+            if (windowIds.size() == threadBatchSize ||
+                std::chrono::steady_clock::now() - lastPublished >= publishInterval)
+            {
+                appendThreads(database, windowIds, batch);
+                windowIds.clear();
+
+                publishThreads(batch);
+                lastPublished = std::chrono::steady_clock::now();
+            }
+        }
     }
 
-    StatusBar::instance().update();
-    makeSelectionVisible();
+    bool exhausted = !notmuch_messages_valid(messages);
+    notmuch_messages_destroy(messages);
+
+    if (!_cancelled)
+        appendThreads(database, windowIds, batch);
+
+    int threadCount = -1;
+
+    if (exhausted)
+        threadCount = index;
+    else if (!_cancelled && (changed || !counted))
+        threadCount = notmuch_query_count_threads(query);
+
+    notmuch_query_destroy(query);
+
+    _reusable.clear();
+    _reusableIndices.clear();
+
+    publishThreads(batch, true, threadCount);
 }
 
-int SearchView::lineCount() const
+bool SearchView::dropChangedThreads(notmuch_database_t * database, unsigned long revision)
 {
-    return _threads.size();
+    std::unordered_set<std::string> changedIds;
+    std::ostringstream changedTerms;
+    changedTerms << "lastmod:" << (_revision + 1) << ".." << revision;
+
+    notmuch_query_t * query = notmuch_query_create(database, changedTerms.str().c_str());
+    notmuch_messages_t * messages;
+
+    for (messages = notmuch_query_search_messages(query);
+        notmuch_messages_valid(messages) && changedIds.size() <= maxChangedThreads;
+        notmuch_messages_move_to_next(messages))
+    {
+        notmuch_message_t * message = notmuch_messages_get(messages);
+        std::string threadId(notmuch_message_get_thread_id(message));
+        notmuch_message_destroy(message);
+
+        if (changedIds.insert(threadId).second)
+            _reusableIndices.erase(threadId);
+    }
+
+    notmuch_messages_destroy(messages);
+    notmuch_query_destroy(query);
+
+    return changedIds.size() <= maxChangedThreads;
 }
 
-void SearchView::collectThreads()
+void SearchView::appendThreads(notmuch_database_t * database, const std::vector<std::string> & ids,
+    NotMuch::ThreadTable & batch)
 {
-    std::unique_lock<std::mutex> lock(_mutex);
-    lock.unlock();
+    std::string threadTerms;
 
-    notmuch_database_t * database = NotMuch::openDatabase();
-    notmuch_query_t * query = notmuch_query_create(database, _searchTerms.c_str());
-    notmuch_query_set_sort(query, NerConfig::instance().sortMode());
-    notmuch_threads_t * threadIterator;
+    for (auto id = ids.begin(), e = ids.end(); id != e; ++id)
+    {
+        if (_reusableIndices.find(*id) == _reusableIndices.end())
+        {
+            threadTerms.append(threadTerms.empty() ? "(" : " or ");
+            threadTerms.append("thread:" + *id);
+        }
+    }
 
-    for (threadIterator = notmuch_query_search_threads(query);
-        notmuch_threads_valid(threadIterator) && _collecting;
-        notmuch_threads_move_to_next(threadIterator))
+    /* Fetch the threads we don't already have in one go */
+    if (!threadTerms.empty())
     {
-        lock.lock();
+        std::string terms("(" + _searchTerms + ") and " + threadTerms + ")");
+        notmuch_query_t * query = notmuch_query_create(database, terms.c_str());
+        notmuch_threads_t * threadIterator;
 
-        notmuch_thread_t * thread = notmuch_threads_get(threadIterator);
-        _threads.push_back(thread);
-        notmuch_thread_destroy(thread);
+        for (threadIterator = notmuch_query_search_threads(query);
+            notmuch_threads_valid(threadIterator);
+            notmuch_threads_move_to_next(threadIterator))
+        {
+            notmuch_thread_t * thread = notmuch_threads_get(threadIterator);
+            _reusableIndices[notmuch_thread_get_thread_id(thread)] = _reusable.append(thread);
+            notmuch_thread_destroy(thread);
+        }
 
-        _condition.notify_one();
+        notmuch_threads_destroy(threadIterator);
+        notmuch_query_destroy(query);
+    }
 
-        lock.unlock();
+    for (auto id = ids.begin(), e = ids.end(); id != e; ++id)
+    {
+        auto index = _reusableIndices.find(*id);
 
-        sched_yield();
+        /* The thread may have stopped matching since we came across it */
+        if (index != _reusableIndices.end())
+            batch.append(_reusable, index->second);
     }
+}
 
-    _collecting = false;
-    notmuch_threads_destroy(threadIterator);
-    notmuch_query_destroy(query);
-    notmuch_database_close(database);
+void SearchView::publishThreads(NotMuch::ThreadTable & batch, bool finished, int threadCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (batch.size() > 0)
+        {
+            _published.push_back(std::move(batch));
+            batch.clear();
+        }
+
+        if (finished)
+        {
+            _publishedAll = true;
+            _publishedCount = threadCount;
+        }
+    }
 
-    /* For cases when there are no matching threads */
-    _condition.notify_one();
+    /* Wake up the UI thread to draw the new threads */
+    EventLoop::instance().post([] { ViewManager::instance().requestUpdate(); });
 }
 
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
@@ -21,10 +21,19 @@
 #define NER_SEARCH_VIEW 1
 
 #include <string>
+#include <deque>
+#include <memory>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 
 #include "line_browser_view.hh"
 #include "notmuch.hh"
+#include "thread_table.hh"
+
+class ThreadMessageView;
 
 class SearchView : public LineBrowserView
 {
@@ -36,6 +45,7 @@ class SearchView : public LineBrowserView
         virtual void update();
         virtual std::string name() const { return "search-view"; }
         virtual std::vector<std::string> status() const;
+        virtual void databaseChanged();
 
         void openSelectedThread();
         void refreshThreads();
@@ -44,16 +54,129 @@ class SearchView : public LineBrowserView
         virtual int lineCount() const;
 
     private:
-        void collectThreads();
+        /**
+         * Starts collecting the window of threads beginning at the given
+         * index in the background.
+         *
+         * Threads in the current window which haven't changed since they
+         * were collected are reused. If the window doesn't move, its threads
+         * are displayed until the first new ones arrive.
+         *
+         * \param start The index of the first thread in the window.
+         */
+        void collectWindow(int start);
+        void stopCollecting();
+
+        /**
+         * Returns whether the window holds (or is collecting) the threads in
+         * the range [first, last).
+         */
+        bool windowCovers(int first, int last) const;
+
+        /**
+         * Moves the batches published by the collector into the window.
+         *
+         * \return Whether the window or the collection progress changed.
+         */
+        bool takeThreads();
+
+        void collectThreads(int start, bool counted);
+
+        /**
+         * Drops threads changed after _revision from _reusable.
+         *
+         * \return Whether the changed threads could be determined.
+         */
+        bool dropChangedThreads(notmuch_database_t * database, unsigned long revision);
+
+        /**
+         * Appends the threads with the given IDs to the batch, fetching any
+         * that can't be reused.
+         */
+        void appendThreads(notmuch_database_t * database, const std::vector<std::string> & ids,
+            NotMuch::ThreadTable & batch);
+
+        /**
+         * Hands a batch of threads over to the UI thread.
+         */
+        void publishThreads(NotMuch::ThreadTable & batch, bool finished = false,
+            int threadCount = -1);
+
+        /**
+         * Starts preloading the selected thread once the selection has
+         * stayed on it for a moment.
+         */
+        void schedulePreload();
+        void preloadThread();
+
+        /**
+         * Drops the preloaded views, cancelling their loaders.
+         */
+        void retirePreloaded(size_t count);
+
+        /**
+         * Destroys the retired views whose loaders have stopped.
+         */
+        void destroyRetired();
 
         std::string _searchTerms;
 
         std::thread _thread;
+        std::atomic<bool> _cancelled;
+
+        /* Batches published by the collector, protected by _mutex */
         std::mutex _mutex;
-        std::condition_variable _condition;
+        std::vector<NotMuch::ThreadTable> _published;
+        bool _publishedAll;
+        int _publishedCount;
+
+        /* The following are only used by the UI thread */
+
+        /* Whether the collector is still running for this window */
         bool _collecting;
+        std::chrono::steady_clock::time_point _collectStart;
+        int _collectedCount;
+        int _progressTimer;
+
+        /* Whether the threads in the window are from before a refresh, and
+         * should be replaced when new threads arrive */
+        bool _replacing;
+
+        /* The thread to select once it is collected, as long as the
+         * selection is still at _pendingSelectionIndex */
+        std::string _pendingSelection;
+        int _pendingSelectionIndex;
+
+        /* The total number of matching threads, or -1 if not counted yet */
+        int _threadCount;
+
+        /* Only a window of the matching threads is kept in memory, starting
+         * with the thread at index _windowStart */
+        int _windowStart;
+        NotMuch::ThreadTable _threads;
+        std::unordered_map<std::string, int> _threadIndices;
+
+        /* The thread the preload timer is for */
+        std::string _preloadId;
+        int _preloadTimer;
+
+        /* Views for recently selected threads, which load in the background
+         * until they are opened */
+        std::deque<std::pair<std::string, std::shared_ptr<ThreadMessageView>>> _preloaded;
+
+        /* Preloaded views which were dropped, kept until their loaders have
+         * stopped so that destroying them doesn't block */
+        std::vector<std::shared_ptr<ThreadMessageView>> _retired;
+
+        /* The following are only used by the collector */
+
+        /* The database revision the collected threads are up to date with */
+        unsigned long _revision;
+        std::string _uuid;
 
-        std::vector<NotMuch::Thread> _threads;
+        /* Threads from the previous window, for the collector to reuse */
+        NotMuch::ThreadTable _reusable;
+        std::unordered_map<std::string, int> _reusableIndices;
 };
 
 #endif
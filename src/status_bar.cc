@@ -24,13 +24,18 @@
 #include "view_manager.hh"
 #include "line_editor.hh"
 #include "util.hh"
+#include "event_loop.hh"
+
+/* How long messages are displayed for */
+const auto messageClearDelay = std::chrono::milliseconds(1500);
 
 StatusBar * StatusBar::_instance = 0;
 
 StatusBar::StatusBar()
     : _statusWindow(newwin(1, COLS, LINES - 2, 0)),
         _promptWindow(newwin(1, COLS, LINES - 1, 0)),
-        _messageCleared(true)
+        _messageCleared(true),
+        _messageClearTimer(0)
 {
     _instance = this;
 
@@ -44,8 +49,8 @@ StatusBar::~StatusBar()
 {
     _instance = 0;
 
-    if (_messageClearThread.joinable())
-        _messageClearThread.join();
+    if (_messageClearTimer)
+        EventLoop::instance().cancelTimer(_messageClearTimer);
 }
 
 void StatusBar::update()
@@ -111,10 +116,11 @@ void StatusBar::displayMessage(const std::string & message)
 
     _messageCleared = false;
 
-    if (_messageClearThread.joinable())
-        _messageClearThread.detach();
+    if (_messageClearTimer)
+        EventLoop::instance().cancelTimer(_messageClearTimer);
 
-    _messageClearThread = std::thread(std::bind(&StatusBar::delayedClearMessage, this, 1500));
+    _messageClearTimer = EventLoop::instance().addTimer(messageClearDelay,
+        std::bind(&StatusBar::clearMessage, this));
 }
 
 std::string StatusBar::prompt(const std::string & message, const std::string & field,
@@ -143,22 +149,18 @@ std::string StatusBar::prompt(const std::string & message, const std::string & f
     return response;
 }
 
-void StatusBar::delayedClearMessage(int delay)
-{
-    usleep(delay * 1000);
-
-    if (_messageCleared)
-        return;
-
-    clearMessage();
-}
-
 void StatusBar::clearMessage()
 {
     werase(_promptWindow);
     wbkgd(_promptWindow, COLOR_PAIR(ColorID::StatusBarPrompt));
     wrefresh(_promptWindow);
     _messageCleared = true;
+
+    if (_messageClearTimer)
+    {
+        EventLoop::instance().cancelTimer(_messageClearTimer);
+        _messageClearTimer = 0;
+    }
 }
 
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
@@ -22,7 +22,6 @@
 
 #include <string>
 #include <vector>
-#include <thread>
 
 #include "ncurses.hh"
 
@@ -50,14 +49,13 @@ class StatusBar
     private:
         static StatusBar * _instance;
 
-        void delayedClearMessage(int delay);
         void clearMessage();
 
         WINDOW * _statusWindow;
         WINDOW * _promptWindow;
 
         bool _messageCleared;
-        std::thread _messageClearThread;
+        int _messageClearTimer;
 };
 
 #endif
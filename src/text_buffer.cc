@@ -0,0 +1,100 @@
+/* ner: src/text_buffer.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "text_buffer.hh"
+
+const int tabWidth = 8;
+
+TextBuffer::TextBuffer()
+    : _lineOpen(false)
+{
+}
+
+void TextBuffer::reserve(size_t size)
+{
+    _text.reserve(size);
+}
+
+void TextBuffer::append(const char * text, size_t length)
+{
+    if (length == 0)
+        return;
+
+    if (!_lineOpen)
+    {
+        _starts.push_back(_text.size());
+        _lineOpen = true;
+    }
+
+    const char * end = text + length;
+
+    while (true)
+    {
+        const char * lineEnd = static_cast<const char *>(std::memchr(text, '\n', end - text));
+
+        if (!lineEnd)
+        {
+            appendText(text, end);
+            break;
+        }
+
+        appendText(text, lineEnd);
+        _starts.push_back(_text.size());
+        text = lineEnd + 1;
+    }
+}
+
+void TextBuffer::addLine(const std::string & line)
+{
+    _starts.push_back(_text.size());
+    _lineOpen = true;
+
+    appendText(line.data(), line.data() + line.size());
+    _lineOpen = false;
+}
+
+void TextBuffer::removeLastLine()
+{
+    _text.resize(_starts.back());
+    _starts.pop_back();
+    _lineOpen = false;
+}
+
+void TextBuffer::appendText(const char * text, const char * end)
+{
+    while (true)
+    {
+        const char * tab = static_cast<const char *>(std::memchr(text, '\t', end - text));
+
+        if (!tab)
+        {
+            _text.append(text, end);
+            break;
+        }
+
+        _text.append(text, tab);
+        _text.append(tabWidth - (_text.size() - _starts.back()) % tabWidth, ' ');
+        text = tab + 1;
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
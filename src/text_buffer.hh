@@ -0,0 +1,106 @@
+/* ner: src/text_buffer.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_TEXT_BUFFER_H
+#define NER_TEXT_BUFFER_H 1
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Lines of text, stored one after another in a single buffer along with the
+ * offset each line starts at.
+ *
+ * Tabs are expanded to spaces as text is added.
+ */
+class TextBuffer
+{
+    public:
+        /* A line in the buffer, which is only valid as long as the buffer
+         * isn't changed */
+        class Line
+        {
+            public:
+                Line(const char * begin, const char * end)
+                    : _begin(begin), _end(end)
+                {
+                }
+
+                const char * begin() const { return _begin; }
+                const char * end() const { return _end; }
+                size_t size() const { return _end - _begin; }
+                bool empty() const { return _begin == _end; }
+
+                std::string str() const { return std::string(_begin, _end); }
+
+            private:
+                const char * _begin;
+                const char * _end;
+        };
+
+        TextBuffer();
+
+        /**
+         * Reserves space for the given number of bytes of text.
+         */
+        void reserve(size_t size);
+
+        /**
+         * Appends text, starting a new line at each newline. Text after the
+         * last newline is continued by the next call.
+         */
+        void append(const char * text, size_t length);
+
+        /**
+         * Adds a complete line.
+         */
+        void addLine(const std::string & line);
+
+        void removeLastLine();
+
+        size_t size() const { return _starts.size(); }
+        bool empty() const { return _starts.empty(); }
+
+        Line operator[](size_t index) const
+        {
+            const char * text = _text.data();
+
+            return Line(text + _starts[index],
+                text + (index + 1 < _starts.size() ? _starts[index + 1] : _text.size()));
+        }
+
+        Line back() const { return (*this)[size() - 1]; }
+
+    private:
+        /* Appends text containing no newlines to the last line */
+        void appendText(const char * text, const char * end);
+
+        /* The lines, without their newlines */
+        std::string _text;
+        std::vector<uint32_t> _starts;
+
+        /* Whether text is still being added to the last line */
+        bool _lineOpen;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -18,19 +18,27 @@
  */
 
 #include "thread_message_view.hh"
+#include "message_cache.hh"
+#include "ner_config.hh"
 #include "notmuch.hh"
 #include "colors.hh"
 
 const int threadViewHeight = 8;
 
-ThreadMessageView::ThreadMessageView(const std::string & threadId, const View::Geometry & geometry)
-    : _threadView(threadId, { geometry.x, geometry.y, geometry.width, threadViewHeight }),
+ThreadMessageView::ThreadMessageView(const std::string & threadId,
+    const std::string & searchTerms, const View::Geometry & geometry)
+    : _threadView(threadId, searchTerms,
+            { geometry.x, geometry.y, geometry.width, threadViewHeight }),
         _messageView({
             geometry.x, geometry.y + threadViewHeight + 1,
             geometry.width, geometry.height - threadViewHeight - 1
-        })
+        }),
+        _messageLoaded(false),
+        _prefetchCancelled(std::make_shared<std::atomic<bool>>(false))
 {
-    _messageView.setMessage(_threadView.selectedMessage().id);
+    /* The thread is loaded in the background, so the message is loaded once
+     * the thread view knows which one to select */
+    loadSelectedMessage();
 
     /* Key Sequences */
     addHandledSequence("j",          std::bind(&MessageView::next, &_messageView));
@@ -51,6 +59,7 @@ ThreadMessageView::ThreadMessageView(const std::string & threadId, const View::G
     addHandledSequence("f",          std::bind(&MessageView::toggleSelectedPartFolding, &_messageView));
 
     addHandledSequence("r",          std::bind(&ThreadView::reply, &_threadView));
+    addHandledSequence("\t",        std::bind(&ThreadView::toggleSelectedReplies, &_threadView));
 
     addHandledSequence(" ",          std::bind(&ThreadMessageView::nextMessage, this));
     addHandledSequence("<C-n>",      std::bind(&ThreadMessageView::nextMessage, this));
@@ -59,6 +68,7 @@ ThreadMessageView::ThreadMessageView(const std::string & threadId, const View::G
 
 ThreadMessageView::~ThreadMessageView()
 {
+    *_prefetchCancelled = true;
 }
 
 void ThreadMessageView::update()
@@ -66,6 +76,10 @@ void ThreadMessageView::update()
     mvhline(threadViewHeight, 0, 0, COLS);
 
     _threadView.update();
+
+    if (!_messageLoaded)
+        loadSelectedMessage();
+
     _messageView.update();
 }
 
@@ -84,6 +98,16 @@ void ThreadMessageView::resize(const View::Geometry & geometry)
     });
 }
 
+void ThreadMessageView::cancelLoading()
+{
+    _threadView.cancelLoading();
+}
+
+bool ThreadMessageView::loaderFinished() const
+{
+    return _threadView.loaderFinished();
+}
+
 void ThreadMessageView::nextMessage()
 {
     _threadView.next();
@@ -100,7 +124,22 @@ void ThreadMessageView::previousMessage()
 
 void ThreadMessageView::loadSelectedMessage()
 {
+    if (!_threadView.hasSelection())
+        return;
+
     _messageView.setMessage(_threadView.selectedMessage().id);
+    _messageLoaded = true;
+
+    prefetchNeighbours();
+}
+
+void ThreadMessageView::prefetchNeighbours()
+{
+    std::vector<const NotMuch::Message *> messages(
+        _threadView.neighbouringMessages(NerConfig::instance().prefetchDepth()));
+
+    for (auto message = messages.begin(), e = messages.end(); message != e; ++message)
+        MessageCache::instance().prefetch((*message)->filename, _prefetchCancelled);
 }
 
 std::vector<std::string> ThreadMessageView::status() const
@@ -20,6 +20,9 @@
 #ifndef NER_THREAD_MESSAGE_VIEW_H
 #define NER_THREAD_MESSAGE_VIEW_H 1
 
+#include <memory>
+#include <atomic>
+
 #include "thread_view.hh"
 #include "message_view.hh"
 
@@ -27,6 +30,7 @@ class ThreadMessageView : public View
 {
     public:
         ThreadMessageView(const std::string & threadId,
+            const std::string & searchTerms = std::string(),
             const View::Geometry & geometry = View::Geometry());
         virtual ~ThreadMessageView();
 
@@ -40,12 +44,29 @@ class ThreadMessageView : public View
         void nextMessage();
         void previousMessage();
 
+        /**
+         * Stops loading the thread in the background.
+         */
+        void cancelLoading();
+
+        bool loaderFinished() const;
+
     protected:
         void loadSelectedMessage();
 
     private:
+        /**
+         * Parses the messages around the selected one in the background, so
+         * that moving to them is quick.
+         */
+        void prefetchNeighbours();
+
         ThreadView _threadView;
         MessageView _messageView;
+        bool _messageLoaded;
+
+        /* Set when the view is closed, so that queued prefetches are skipped */
+        std::shared_ptr<std::atomic<bool>> _prefetchCancelled;
 };
 
 #endif
@@ -0,0 +1,207 @@
+/* ner: src/thread_table.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "thread_table.hh"
+
+using namespace NotMuch;
+
+/* The average number of bytes of strings per thread, for reserve() */
+const int averageStringSize = 96;
+
+TagDictionary & TagDictionary::instance()
+{
+    static TagDictionary dictionary;
+    return dictionary;
+}
+
+TagDictionary::TagDictionary()
+    : _names{ "unread", "flagged" }
+{
+    for (TagId id = 0; id < _names.size(); ++id)
+        _ids[_names[id]] = id;
+}
+
+TagId TagDictionary::id(const std::string & name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto id = _ids.find(name);
+
+    if (id != _ids.end())
+        return id->second;
+
+    _names.push_back(name);
+    _ids[name] = _names.size() - 1;
+
+    return _names.size() - 1;
+}
+
+std::string TagDictionary::name(TagId id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _names.at(id);
+}
+
+TagSet::TagSet()
+    : _bits(0)
+{
+}
+
+void TagSet::insert(TagId id)
+{
+    if (id < 64)
+        _bits |= uint64_t(1) << id;
+    else
+    {
+        int word = id / 64 - 1;
+
+        if (word >= _overflow.size())
+            _overflow.resize(word + 1);
+
+        _overflow[word] |= uint64_t(1) << (id % 64);
+    }
+}
+
+bool TagSet::contains(TagId id) const
+{
+    if (id < 64)
+        return _bits & (uint64_t(1) << id);
+    else
+    {
+        int word = id / 64 - 1;
+
+        return word < _overflow.size() && _overflow[word] & (uint64_t(1) << (id % 64));
+    }
+}
+
+std::vector<TagId> TagSet::ids() const
+{
+    std::vector<TagId> ids;
+
+    for (int word = 0; word <= _overflow.size(); ++word)
+    {
+        uint64_t bits = word == 0 ? _bits : _overflow[word - 1];
+
+        for (TagId bit = 0; bits; ++bit, bits >>= 1)
+        {
+            if (bits & 1)
+                ids.push_back(word * 64 + bit);
+        }
+    }
+
+    return ids;
+}
+
+void ThreadTable::reserve(int threads)
+{
+    _strings.reserve(threads * averageStringSize);
+    _ids.reserve(threads);
+    _subjects.reserve(threads);
+    _authors.reserve(threads);
+    _totalMessages.reserve(threads);
+    _matchedMessages.reserve(threads);
+    _newestDates.reserve(threads);
+    _oldestDates.reserve(threads);
+    _tags.reserve(threads);
+}
+
+void ThreadTable::clear()
+{
+    _strings.clear();
+    _ids.clear();
+    _subjects.clear();
+    _authors.clear();
+    _totalMessages.clear();
+    _matchedMessages.clear();
+    _newestDates.clear();
+    _oldestDates.clear();
+    _tags.clear();
+}
+
+int ThreadTable::append(notmuch_thread_t * thread)
+{
+    _ids.push_back(addString(notmuch_thread_get_thread_id(thread)));
+    _subjects.push_back(addString(notmuch_thread_get_subject(thread) ? : "(null)"));
+    _authors.push_back(addString(notmuch_thread_get_authors(thread) ? : "(null)"));
+    _totalMessages.push_back(notmuch_thread_get_total_messages(thread));
+    _matchedMessages.push_back(notmuch_thread_get_matched_messages(thread));
+    _newestDates.push_back(notmuch_thread_get_newest_date(thread));
+    _oldestDates.push_back(notmuch_thread_get_oldest_date(thread));
+
+    TagSet tags;
+    notmuch_tags_t * tagIterator;
+
+    for (tagIterator = notmuch_thread_get_tags(thread);
+        notmuch_tags_valid(tagIterator);
+        notmuch_tags_move_to_next(tagIterator))
+    {
+        tags.insert(TagDictionary::instance().id(notmuch_tags_get(tagIterator)));
+    }
+
+    notmuch_tags_destroy(tagIterator);
+
+    _tags.push_back(std::move(tags));
+
+    return size() - 1;
+}
+
+int ThreadTable::append(const ThreadTable & other, int index)
+{
+    _ids.push_back(addString(other.id(index)));
+    _subjects.push_back(addString(other.subject(index)));
+    _authors.push_back(addString(other.authors(index)));
+    _totalMessages.push_back(other._totalMessages[index]);
+    _matchedMessages.push_back(other._matchedMessages[index]);
+    _newestDates.push_back(other._newestDates[index]);
+    _oldestDates.push_back(other._oldestDates[index]);
+    _tags.push_back(other._tags[index]);
+
+    return size() - 1;
+}
+
+std::vector<std::string> ThreadTable::tagNames(int index) const
+{
+    std::vector<TagId> ids(_tags[index].ids());
+    std::vector<std::string> names;
+
+    names.reserve(ids.size());
+
+    for (auto id = ids.begin(), e = ids.end(); id != e; ++id)
+        names.push_back(TagDictionary::instance().name(*id));
+
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+ThreadTable::StringRef ThreadTable::addString(const char * string)
+{
+    StringRef offset = _strings.size();
+
+    _strings.insert(_strings.end(), string, string + std::strlen(string) + 1);
+
+    return offset;
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
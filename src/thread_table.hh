@@ -0,0 +1,152 @@
+/* ner: src/thread_table.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_THREAD_TABLE_H
+#define NER_THREAD_TABLE_H 1
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <notmuch.h>
+
+namespace NotMuch
+{
+    typedef uint32_t TagId;
+
+    /**
+     * Maps tag names to small integer IDs, shared by all thread tables.
+     *
+     * This class is a singleton, and may be used from any thread.
+     */
+    class TagDictionary
+    {
+        public:
+            static TagDictionary & instance();
+
+            /* Tags with fixed IDs, for quick tests while drawing */
+            static const TagId unread = 0;
+            static const TagId flagged = 1;
+
+            TagId id(const std::string & name);
+            std::string name(TagId id);
+
+        private:
+            TagDictionary();
+
+            std::mutex _mutex;
+            std::unordered_map<std::string, TagId> _ids;
+            std::vector<std::string> _names;
+    };
+
+    /**
+     * A set of tag IDs.
+     *
+     * The first 64 tags fit in place; only threads with less common tags
+     * need any more memory.
+     */
+    class TagSet
+    {
+        public:
+            TagSet();
+
+            void insert(TagId id);
+            bool contains(TagId id) const;
+
+            /**
+             * Returns the IDs of the tags in this set, in increasing order.
+             */
+            std::vector<TagId> ids() const;
+
+        private:
+            uint64_t _bits;
+            std::vector<uint64_t> _overflow;
+    };
+
+    /**
+     * A table of thread summaries, as shown by the search view.
+     *
+     * Each field is kept in its own column, and all the strings of a table
+     * share a single buffer.
+     */
+    class ThreadTable
+    {
+        public:
+            int size() const { return _totalMessages.size(); }
+
+            void reserve(int threads);
+            void clear();
+
+            /**
+             * Appends the summary of a notmuch thread.
+             *
+             * \return The index of the new row.
+             */
+            int append(notmuch_thread_t * thread);
+
+            /**
+             * Appends a row copied from another table.
+             *
+             * \return The index of the new row.
+             */
+            int append(const ThreadTable & other, int index);
+
+            /* The returned strings are valid until the table is modified */
+            const char * id(int index) const { return stringAt(_ids[index]); }
+            const char * subject(int index) const { return stringAt(_subjects[index]); }
+            const char * authors(int index) const { return stringAt(_authors[index]); }
+
+            uint32_t totalMessages(int index) const { return _totalMessages[index]; }
+            uint32_t matchedMessages(int index) const { return _matchedMessages[index]; }
+            time_t newestDate(int index) const { return _newestDates[index]; }
+            time_t oldestDate(int index) const { return _oldestDates[index]; }
+
+            const TagSet & tags(int index) const { return _tags[index]; }
+            bool hasTag(int index, TagId tag) const { return _tags[index].contains(tag); }
+
+            /**
+             * Returns the names of the tags of a thread, sorted by name.
+             */
+            std::vector<std::string> tagNames(int index) const;
+
+        private:
+            /* Offset of a null-terminated string in _strings */
+            typedef uint32_t StringRef;
+
+            StringRef addString(const char * string);
+            const char * stringAt(StringRef offset) const { return _strings.data() + offset; }
+
+            std::vector<char> _strings;
+
+            std::vector<StringRef> _ids;
+            std::vector<StringRef> _subjects;
+            std::vector<StringRef> _authors;
+            std::vector<uint32_t> _totalMessages;
+            std::vector<uint32_t> _matchedMessages;
+            std::vector<time_t> _newestDates;
+            std::vector<time_t> _oldestDates;
+            std::vector<TagSet> _tags;
+    };
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -19,9 +19,11 @@
 
 #include <sstream>
 #include <iterator>
+#include <algorithm>
 
 #include "thread_view.hh"
 #include "notmuch.hh"
+#include "database_pool.hh"
 #include "util.hh"
 #include "colors.hh"
 #include "ncurses.hh"
@@ -29,80 +31,67 @@
 #include "message_view.hh"
 #include "status_bar.hh"
 #include "reply_view.hh"
-
-ThreadView::ThreadView(const std::string & threadId, const View::Geometry & geometry)
-    : LineBrowserView(geometry), _id(threadId)
+#include "event_loop.hh"
+#include "message_cache.hh"
+
+/* The number of messages to load before handing them to the UI */
+const int messageBatchSize = 64;
+
+ThreadView::ThreadView(const std::string & threadId, const std::string & searchTerms,
+    const View::Geometry & geometry)
+    : LineBrowserView(geometry),
+        _id(threadId),
+        _searchTerms(searchTerms),
+        _cancelled(false),
+        _loaderFinished(false),
+        _publishedAll(false),
+        _publishedCount(-1),
+        _publishedUnread(false),
+        _initialUnread(false),
+        _loading(true),
+        _selectionPending(true),
+        _messageCount(-1),
+        _hiddenCount(0)
 {
-    notmuch_database_t * database = NotMuch::openDatabase();
-    notmuch_query_t * query = notmuch_query_create(database, ("thread:" + threadId).c_str());
-    notmuch_threads_t * threads = notmuch_query_search_threads(query);
-    notmuch_thread_t * thread = 0;
-    notmuch_messages_t * messages;
-
-    if (!notmuch_threads_valid(threads) || !(thread = notmuch_threads_get(threads)))
-    {
-        notmuch_threads_destroy(threads);
-        notmuch_query_destroy(query);
-
-        notmuch_database_close(database);
-
-        throw NotMuch::InvalidThreadException(threadId);
-    }
-
-    for (messages = notmuch_thread_get_toplevel_messages(thread);
-        notmuch_messages_valid(messages);
-        notmuch_messages_move_to_next(messages))
-    {
-        _topMessages.push_back(notmuch_messages_get(messages));
-    }
-
-    notmuch_messages_destroy(messages);
-    notmuch_threads_destroy(threads);
-    notmuch_query_destroy(query);
-
-    notmuch_database_close(database);
-
-    _messageCount = notmuch_thread_get_total_messages(thread);
-
-    _selectedIndex = 0;
-
-    /* Find first unread message */
-    int messageIndex = 0;
-
-    for (NotMuch::Message::const_iterator message(_topMessages.rbegin(), _topMessages.rend()), e;
-        message != e; ++message, ++messageIndex)
-    {
-        if (message->tags.find("unread") != message->tags.end())
-        {
-            _selectedIndex = messageIndex;
-            break;
-        }
-    }
-
-    makeSelectionVisible();
+    /* Load the messages in the background */
+    _thread = std::thread(std::bind(&ThreadView::loadMessages, this));
 
     /* Key Sequences */
     addHandledSequence("\n", std::bind(&ThreadView::openSelectedMessage, this));
     addHandledSequence("r", std::bind(&ThreadView::reply, this));
+    addHandledSequence("\t", std::bind(&ThreadView::toggleSelectedReplies, this));
 }
 
 ThreadView::~ThreadView()
 {
+    _cancelled = true;
+    _thread.join();
+}
+
+void ThreadView::cancelLoading()
+{
+    _cancelled = true;
+}
+
+bool ThreadView::loaderFinished() const
+{
+    return _loaderFinished;
 }
 
 void ThreadView::update()
 {
-    std::vector<chtype> leading;
+    if (takeMessages())
+    {
+        StatusBar::instance().update();
+        StatusBar::instance().refresh();
+    }
 
     werase(_window);
 
-    int index = 0;
-
-    for (auto message = _topMessages.begin(), e = _topMessages.end();
-        message != e && index < getmaxy(_window) + _offset;
-        ++message)
+    for (int row = 0, index = _offset; row < getmaxy(_window) && index < _messages.size();
+        ++row, ++index)
     {
-        index = displayMessageLine(*message, leading, (message + 1) == e, index);
+        displayMessageLine(_messages[index], row, index == _selectedIndex);
     }
 }
 
@@ -110,16 +99,33 @@ std::vector<std::string> ThreadView::status() const
 {
     std::ostringstream messagePosition;
 
-    messagePosition << "message " << (_selectedIndex + 1) << " of " << _messageCount;
+    messagePosition << "message " << (_selectedIndex + 1) << " of "
+        << (_messageCount >= 0 ? _messageCount : lineCount());
 
-    return std::vector<std::string>{
+    std::vector<std::string> status{
         "thread:" + _id,
         messagePosition.str()
     };
+
+    if (_hiddenCount > 0)
+        status.push_back(std::to_string(_hiddenCount) + " collapsed");
+
+    if (_loading)
+        status.push_back("loading");
+
+    return status;
+}
+
+bool ThreadView::hasSelection() const
+{
+    return !_selectionPending && _selectedIndex < _messages.size();
 }
 
 void ThreadView::openSelectedMessage()
 {
+    if (!hasSelection())
+        return;
+
     try
     {
         std::shared_ptr<MessageView> messageView(new MessageView());
@@ -134,13 +140,33 @@ void ThreadView::openSelectedMessage()
 
 const NotMuch::Message & ThreadView::selectedMessage() const
 {
-    NotMuch::Message::const_iterator message(_topMessages.rbegin(), _topMessages.rend());
-    std::advance(message, _selectedIndex);
-    return *message;
+    return _messages.at(_selectedIndex).message;
+}
+
+std::vector<const NotMuch::Message *> ThreadView::neighbouringMessages(int distance) const
+{
+    std::vector<const NotMuch::Message *> messages;
+
+    if (!hasSelection())
+        return messages;
+
+    for (int index = _selectedIndex + 1;
+        index <= _selectedIndex + distance && index < _messages.size(); ++index)
+    {
+        messages.push_back(&_messages[index].message);
+    }
+
+    for (int index = _selectedIndex - 1; index >= _selectedIndex - distance && index >= 0; --index)
+        messages.push_back(&_messages[index].message);
+
+    return messages;
 }
 
 void ThreadView::reply()
 {
+    if (!hasSelection())
+        return;
+
     try
     {
         ViewManager::instance().addView(std::make_shared<ReplyView>(selectedMessage().id));
@@ -151,99 +177,472 @@ void ThreadView::reply()
     }
 }
 
+void ThreadView::toggleSelectedReplies()
+{
+    /* The loader may still be appending messages after the selected one */
+    if (_loading || !hasSelection())
+        return;
+
+    const MessageLine & line = _messages[_selectedIndex];
+
+    if (line.hiddenReplies > 0)
+        expandReplies(_selectedIndex);
+    else if (_selectedIndex + 1 < _messages.size()
+        && _messages[_selectedIndex + 1].parent == _selectedIndex)
+    {
+        collapseReplies(_selectedIndex);
+    }
+    else
+        return;
+
+    StatusBar::instance().update();
+    StatusBar::instance().refresh();
+}
+
 int ThreadView::lineCount() const
 {
-    return _messageCount;
+    return _messages.size();
 }
 
-uint32_t ThreadView::displayMessageLine(const NotMuch::Message & message,
-    std::vector<chtype> & leading, bool last, int index)
+bool ThreadView::takeMessages()
 {
-    if (index >= _offset)
+    std::vector<MessageLine> messages;
+    bool finished;
+    int messageCount;
+    bool unread;
+
     {
-        try
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        messages.swap(_published);
+        finished = _publishedAll;
+        messageCount = _publishedCount;
+        unread = _publishedUnread;
+    }
+
+    if (!_loading || (messages.empty() && !finished))
+        return false;
+
+    int firstNew = _messages.size();
+
+    for (auto line = messages.begin(), e = messages.end(); line != e; ++line)
+        _hiddenCount += line->hiddenReplies;
+
+    std::move(messages.begin(), messages.end(), std::back_inserter(_messages));
+
+    _messageCount = messageCount;
+
+    /* Select the first unread message, unless the selection has been moved
+     * in the meantime */
+    if (_selectionPending)
+    {
+        if (_selectedIndex != 0 || (messageCount >= 0 && !unread))
+            _selectionPending = false;
+        else
         {
-            bool selected = index == _selectedIndex;
-            bool unread = message.tags.find("unread") != message.tags.end();
+            for (int index = firstNew; index < _messages.size(); ++index)
+            {
+                const NotMuch::Message & message = _messages[index].message;
+
+                if (message.tags.find("unread") != message.tags.end())
+                {
+                    _selectedIndex = index;
+                    _selectionPending = false;
+                    makeSelectionVisible();
+                    break;
+                }
+            }
+        }
+    }
 
-            int x = 0;
-            int row = index - _offset;
+    if (finished)
+    {
+        _loading = false;
+        _selectionPending = false;
 
-            wmove(_window, row, x);
+        if (messageCount < 0)
+            StatusBar::instance().displayMessage("Cannot find thread with ID: " + _id);
+    }
 
-            attr_t attributes = 0;
+    return true;
+}
 
-            if (selected)
-                attributes |= A_REVERSE;
+void ThreadView::loadMessages()
+{
+    NotMuch::Database database;
+    notmuch_query_t * query;
+    notmuch_thread_t * thread = findThread(database, query);
+    std::vector<MessageLine> batch;
+
+    if (thread)
+    {
+        bool unread = false;
+        notmuch_tags_t * tags;
 
-            if (unread)
-                attributes |= A_BOLD;
+        for (tags = notmuch_thread_get_tags(thread);
+            notmuch_tags_valid(tags);
+            notmuch_tags_move_to_next(tags))
+        {
+            if (std::string(notmuch_tags_get(tags)) == "unread")
+                unread = true;
+        }
 
-            wchgat(_window, -1, attributes, 0, NULL);
+        notmuch_tags_destroy(tags);
 
-            x += NCurses::addPlainString(_window, leading.begin(), leading.end(),
-                attributes, ColorID::ThreadViewArrow);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _publishedCount = notmuch_thread_get_total_messages(thread);
+            _publishedUnread = unread;
+        }
 
-            NCurses::checkMove(_window, x);
+        ReplySummaries summaries;
+        notmuch_messages_t * messages;
 
-            x += NCurses::addChar(_window, last ? ACS_LLCORNER : ACS_LTEE,
-                attributes, ColorID::ThreadViewArrow);
+        for (messages = notmuch_thread_get_toplevel_messages(thread);
+            notmuch_messages_valid(messages) && !_cancelled;
+            notmuch_messages_move_to_next(messages))
+        {
+            notmuch_message_t * message = notmuch_messages_get(messages);
 
-            NCurses::checkMove(_window, x);
+            if (_initialFilename.empty())
+                _initialFilename = notmuch_message_get_filename(message);
 
-            x += NCurses::addChar(_window, '>', attributes, ColorID::ThreadViewArrow);
+            summarizeReplies(message, summaries);
+        }
 
-            NCurses::checkMove(_window, ++x);
+        notmuch_messages_destroy(messages);
 
-            /* Sender */
-            x += NCurses::addUtf8String(_window, (*message.headers.find("From")).second.c_str(),
-                attributes);
+        std::vector<chtype> leading;
+        int count = 0;
 
-            NCurses::checkMove(_window, ++x);
+        messages = notmuch_thread_get_toplevel_messages(thread);
+        appendMessages(messages, -1, leading, summaries, batch, count, true);
+        notmuch_messages_destroy(messages);
 
-            /* Date */
-            x += NCurses::addPlainString(_window, relativeTime(message.date),
-                attributes, ColorID::ThreadViewDate);
+        notmuch_query_destroy(query);
+    }
 
-            NCurses::checkMove(_window, ++x);
+    publishMessages(batch, true);
 
-            /* Tags */
-            std::ostringstream tagStream;
-            std::copy(message.tags.begin(), message.tags.end(),
-                std::ostream_iterator<std::string>(tagStream, " "));
-            std::string tags(tagStream.str());
+    /* Parse and decode the message which is displayed first while we are
+     * still in the background, so it is ready when the view is shown */
+    if (!_cancelled && !_initialFilename.empty())
+        MessageCache::instance().prepare(_initialFilename);
 
-            if (tags.size() > 0)
-                /* Get rid of the trailing space */
-                tags.resize(tags.size() - 1);
+    _loaderFinished = true;
 
-            x += NCurses::addPlainString(_window, tags, attributes, ColorID::ThreadViewTags);
+    /* Views waiting to be destroyed are checked on the next update */
+    EventLoop::instance().post([] { ViewManager::instance().requestUpdate(); });
+}
 
-            NCurses::checkMove(_window, x - 1);
+ThreadView::ReplySummary ThreadView::summarizeReplies(notmuch_message_t * message,
+    ReplySummaries & summaries)
+{
+    ReplySummary summary{ 0, false };
+    notmuch_messages_t * replies;
+
+    for (replies = notmuch_message_get_replies(message);
+        notmuch_messages_valid(replies);
+        notmuch_messages_move_to_next(replies))
+    {
+        notmuch_message_t * reply = notmuch_messages_get(replies);
+        ReplySummary replySummary = summarizeReplies(reply, summaries);
+
+        summary.count += replySummary.count + 1;
+
+        if (replySummary.interesting
+            || notmuch_message_get_flag(reply, NOTMUCH_MESSAGE_FLAG_MATCH))
+        {
+            summary.interesting = true;
+            continue;
         }
-        catch (const NCurses::CutOffException & e)
+
+        notmuch_tags_t * tags;
+
+        for (tags = notmuch_message_get_tags(reply);
+            notmuch_tags_valid(tags);
+            notmuch_tags_move_to_next(tags))
         {
-            NCurses::addCutOffIndicator(_window);
+            if (std::string(notmuch_tags_get(tags)) == "unread")
+                summary.interesting = true;
         }
+
+        notmuch_tags_destroy(tags);
     }
 
-    ++index;
+    notmuch_messages_destroy(replies);
 
-    if (last)
-        leading.push_back(' ');
-    else
-        leading.push_back(ACS_VLINE);
+    summaries[message] = summary;
+
+    return summary;
+}
+
+notmuch_thread_t * ThreadView::findThread(notmuch_database_t * database,
+    notmuch_query_t *& query) const
+{
+    std::vector<std::string> queryStrings;
+
+    /* Without search terms, every message in the thread matches */
+    if (!_searchTerms.empty())
+        queryStrings.push_back("thread:" + _id + " and (" + _searchTerms + ")");
+
+    /* The thread may no longer match the search terms */
+    queryStrings.push_back("thread:" + _id);
 
-    for (auto reply = message.replies.begin(), e = message.replies.end();
-        reply != e && index < getmaxy(_window) + _offset;
-        ++reply)
+    for (auto queryString = queryStrings.begin(), e = queryStrings.end();
+        queryString != e; ++queryString)
     {
-        index = displayMessageLine(*reply, leading, (reply + 1) == e, index);
+        query = notmuch_query_create(database, queryString->c_str());
+        notmuch_threads_t * threads = notmuch_query_search_threads(query);
+
+        if (notmuch_threads_valid(threads))
+            return notmuch_threads_get(threads);
+
+        notmuch_query_destroy(query);
+    }
+
+    query = 0;
+
+    return 0;
+}
+
+void ThreadView::appendMessages(notmuch_messages_t * messages, int parent,
+    std::vector<chtype> & leading, const ReplySummaries & summaries,
+    std::vector<MessageLine> & batch, int & count, bool publish)
+{
+    /* We need to know which message is the last one up front */
+    std::vector<notmuch_message_t *> siblings;
+
+    for (; notmuch_messages_valid(messages); notmuch_messages_move_to_next(messages))
+        siblings.push_back(notmuch_messages_get(messages));
+
+    for (auto message = siblings.begin(), e = siblings.end(); message != e && !_cancelled;
+        ++message)
+    {
+        bool last = (message + 1) == e;
+        int index = count++;
+
+        const ReplySummary & replies = summaries.at(*message);
+        int hiddenReplies = replies.interesting ? 0 : replies.count;
+
+        batch.push_back(MessageLine{ NotMuch::Message(*message), int(leading.size()),
+            parent, last, leading, hiddenReplies });
+        batch.back().prefix.push_back(last ? ACS_LLCORNER : ACS_LTEE);
+
+        const NotMuch::Message & line = batch.back().message;
+
+        /* The first unread message is selected initially */
+        if (publish && !_initialUnread && line.tags.find("unread") != line.tags.end())
+        {
+            _initialFilename = line.filename;
+            _initialUnread = true;
+        }
+
+        if (publish && batch.size() == messageBatchSize)
+            publishMessages(batch);
+
+        if (hiddenReplies > 0)
+            continue;
+
+        leading.push_back(last ? ' ' : ACS_VLINE);
+
+        notmuch_messages_t * replyMessages = notmuch_message_get_replies(*message);
+        appendMessages(replyMessages, index, leading, summaries, batch, count, publish);
+        notmuch_messages_destroy(replyMessages);
+
+        leading.pop_back();
+    }
+}
+
+void ThreadView::expandReplies(int index)
+{
+    /* Find the message by following the path to it from the top of the
+     * thread, since replies are only known within the thread */
+    std::vector<std::string> path;
+
+    for (int ancestor = index; ancestor != -1; ancestor = _messages[ancestor].parent)
+        path.push_back(_messages[ancestor].message.id);
+
+    NotMuch::Database database;
+    notmuch_query_t * query;
+    notmuch_thread_t * thread = findThread(database, query);
+
+    if (!thread)
+    {
+        StatusBar::instance().displayMessage("Cannot find thread with ID: " + _id);
+        return;
     }
 
-    leading.pop_back();
+    notmuch_messages_t * messages = notmuch_thread_get_toplevel_messages(thread);
+    notmuch_message_t * message = 0;
+
+    for (auto id = path.rbegin(), e = path.rend(); id != e; ++id)
+    {
+        for (message = 0; notmuch_messages_valid(messages);
+            notmuch_messages_move_to_next(messages))
+        {
+            if (*id == notmuch_message_get_message_id(notmuch_messages_get(messages)))
+            {
+                message = notmuch_messages_get(messages);
+                break;
+            }
+        }
+
+        notmuch_messages_destroy(messages);
+
+        if (!message)
+            break;
+
+        messages = notmuch_message_get_replies(message);
+    }
+
+    if (!message)
+    {
+        notmuch_query_destroy(query);
+        StatusBar::instance().displayMessage("Cannot find message with ID: " + path.front());
+        return;
+    }
+
+    ReplySummaries summaries;
+    summarizeReplies(message, summaries);
+
+    MessageLine & line = _messages[index];
+    std::vector<chtype> leading(line.prefix.begin(), line.prefix.end() - 1);
+    leading.push_back(line.last ? ' ' : ACS_VLINE);
+
+    std::vector<MessageLine> replies;
+    int count = index + 1;
+
+    appendMessages(messages, index, leading, summaries, replies, count, false);
+    notmuch_messages_destroy(messages);
+    notmuch_query_destroy(query);
+
+    int hiddenReplies = 0;
+
+    for (auto reply = replies.begin(), e = replies.end(); reply != e; ++reply)
+        hiddenReplies += reply->hiddenReplies;
+
+    _hiddenCount += hiddenReplies - line.hiddenReplies;
+    line.hiddenReplies = 0;
 
-    return index;
+    shiftParents(index, replies.size());
+    _messages.insert(_messages.begin() + index + 1,
+        std::make_move_iterator(replies.begin()), std::make_move_iterator(replies.end()));
+}
+
+void ThreadView::collapseReplies(int index)
+{
+    int end = index + 1;
+    int nestedReplies = 0;
+
+    /* Replies which are already collapsed stay hidden */
+    while (end < _messages.size() && _messages[end].depth > _messages[index].depth)
+        nestedReplies += _messages[end++].hiddenReplies;
+
+    int count = end - index - 1;
+
+    _messages.erase(_messages.begin() + index + 1, _messages.begin() + end);
+    shiftParents(index, -count);
+
+    _messages[index].hiddenReplies = count + nestedReplies;
+    _hiddenCount += count;
+}
+
+void ThreadView::shiftParents(int index, int shift)
+{
+    for (auto line = _messages.begin() + index + 1, e = _messages.end(); line != e; ++line)
+    {
+        if (line->parent > index)
+            line->parent += shift;
+    }
+}
+
+void ThreadView::publishMessages(std::vector<MessageLine> & batch, bool finished)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::move(batch.begin(), batch.end(), std::back_inserter(_published));
+        batch.clear();
+
+        if (finished)
+            _publishedAll = true;
+    }
+
+    /* Wake up the UI thread to draw the new messages */
+    EventLoop::instance().post([] { ViewManager::instance().requestUpdate(); });
+}
+
+void ThreadView::displayMessageLine(const MessageLine & line, int row, bool selected)
+{
+    const NotMuch::Message & message = line.message;
+
+    try
+    {
+        bool unread = message.tags.find("unread") != message.tags.end();
+
+        int x = 0;
+
+        wmove(_window, row, x);
+
+        attr_t attributes = 0;
+
+        if (selected)
+            attributes |= A_REVERSE;
+
+        if (unread)
+            attributes |= A_BOLD;
+
+        wchgat(_window, -1, attributes, 0, NULL);
+
+        x += NCurses::addPlainString(_window, line.prefix.begin(), line.prefix.end(),
+            attributes, ColorID::ThreadViewArrow);
+
+        NCurses::checkMove(_window, x);
+
+        x += NCurses::addChar(_window, '>', attributes, ColorID::ThreadViewArrow);
+
+        NCurses::checkMove(_window, ++x);
+
+        /* Collapsed replies */
+        if (line.hiddenReplies > 0)
+        {
+            x += NCurses::addPlainString(_window, "[+" + std::to_string(line.hiddenReplies) + "]",
+                attributes, ColorID::ThreadViewArrow);
+
+            NCurses::checkMove(_window, ++x);
+        }
+
+        /* Sender */
+        x += NCurses::addUtf8String(_window, message.from.c_str(),
+            attributes);
+
+        NCurses::checkMove(_window, ++x);
+
+        /* Date */
+        x += NCurses::addPlainString(_window, relativeTime(message.date),
+            attributes, ColorID::ThreadViewDate);
+
+        NCurses::checkMove(_window, ++x);
+
+        /* Tags */
+        std::ostringstream tagStream;
+        std::copy(message.tags.begin(), message.tags.end(),
+            std::ostream_iterator<std::string>(tagStream, " "));
+        std::string tags(tagStream.str());
+
+        if (tags.size() > 0)
+            /* Get rid of the trailing space */
+            tags.resize(tags.size() - 1);
+
+        x += NCurses::addPlainString(_window, tags, attributes, ColorID::ThreadViewTags);
+
+        NCurses::checkMove(_window, x - 1);
+    }
+    catch (const NCurses::CutOffException & e)
+    {
+        NCurses::addCutOffIndicator(_window);
+    }
 }
 
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
@@ -21,14 +21,26 @@
 #define NER_THREAD_VIEW_H 1
 
 #include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #include "line_browser_view.hh"
 #include "notmuch.hh"
 
+/**
+ * Displays the messages of a thread as a tree.
+ *
+ * Replies which contain no unread messages, and none matching the search
+ * terms the thread was opened from, are collapsed. They are only loaded once
+ * they are expanded.
+ */
 class ThreadView : public LineBrowserView
 {
     public:
         ThreadView(const std::string & threadId,
+            const std::string & searchTerms = std::string(),
             const View::Geometry & geometry = View::Geometry());
         virtual ~ThreadView();
 
@@ -36,22 +48,149 @@ class ThreadView : public LineBrowserView
         virtual std::string name() const { return "thread-view"; }
         virtual std::vector<std::string> status() const;
 
+        /**
+         * Returns whether the initially selected message (the first unread
+         * one) has been loaded, or the selection has been moved since.
+         */
+        bool hasSelection() const;
+
         const NotMuch::Message & selectedMessage() const;
+
+        /**
+         * Returns the messages up to the given distance from the selected
+         * one, the following ones first, closest first.
+         */
+        std::vector<const NotMuch::Message *> neighbouringMessages(int distance) const;
         virtual void openSelectedMessage();
 
         void reply();
 
+        /**
+         * Stops loading messages in the background.
+         */
+        void cancelLoading();
+
+        /**
+         * Returns whether the background loader has stopped, after which
+         * destroying the view doesn't have to wait for it.
+         */
+        bool loaderFinished() const;
+
+        /**
+         * Expands the collapsed replies of the selected message, or
+         * collapses them if they are already shown.
+         */
+        void toggleSelectedReplies();
+
     protected:
         virtual int lineCount() const;
 
         std::string _id;
+        std::string _searchTerms;
 
     private:
-        uint32_t displayMessageLine(const NotMuch::Message & message,
-            std::vector<chtype> & leading, bool last, int index);
+        /* A message in the thread, along with its place in the tree */
+        struct MessageLine
+        {
+            NotMuch::Message message;
+
+            int depth;
+            int parent;
+            bool last;
+
+            /* The tree connectors drawn before the message */
+            std::vector<chtype> prefix;
+
+            /* The number of replies collapsed under the message */
+            int hiddenReplies;
+        };
+
+        /* What we know about the replies to a message without loading them */
+        struct ReplySummary
+        {
+            int count;
+
+            /* Whether any of them is unread or matches the search terms */
+            bool interesting;
+        };
+
+        typedef std::unordered_map<notmuch_message_t *, ReplySummary> ReplySummaries;
+
+        static ReplySummary summarizeReplies(notmuch_message_t * message,
+            ReplySummaries & summaries);
 
-        std::vector<NotMuch::Message> _topMessages;
+        /**
+         * Looks up the thread, preferring a query which also matches the
+         * search terms, so that matched messages are flagged.
+         *
+         * \param query Set to the query owning the thread, which the caller
+         *              must destroy, or 0 if the thread was not found.
+         */
+        notmuch_thread_t * findThread(notmuch_database_t * database,
+            notmuch_query_t *& query) const;
+
+        /**
+         * Moves the messages published by the loader into the view.
+         *
+         * \return Whether the view changed.
+         */
+        bool takeMessages();
+
+        void loadMessages();
+
+        /**
+         * Appends the given messages and their replies to the batch. Replies
+         * which are not interesting are collapsed rather than appended.
+         *
+         * \param leading The connectors for the ancestors of the messages.
+         * \param count The index of the next message.
+         * \param publish Whether to publish the batch as it fills up.
+         */
+        void appendMessages(notmuch_messages_t * messages, int parent,
+            std::vector<chtype> & leading, const ReplySummaries & summaries,
+            std::vector<MessageLine> & batch, int & count, bool publish);
+
+        void expandReplies(int index);
+        void collapseReplies(int index);
+
+        /**
+         * Adjusts the parents of the messages after the given index, once
+         * messages have been inserted or removed before them.
+         */
+        void shiftParents(int index, int shift);
+
+        void publishMessages(std::vector<MessageLine> & batch, bool finished = false);
+
+        void displayMessageLine(const MessageLine & line, int row, bool selected);
+
+        std::thread _thread;
+        std::atomic<bool> _cancelled;
+        std::atomic<bool> _loaderFinished;
+
+        /* Messages published by the loader, protected by _mutex */
+        std::mutex _mutex;
+        std::vector<MessageLine> _published;
+        bool _publishedAll;
+        int _publishedCount;
+        bool _publishedUnread;
+
+        /* The file of the message which will be selected first, only used by
+         * the loader */
+        std::string _initialFilename;
+        bool _initialUnread;
+
+        /* The following are only used by the UI thread */
+        bool _loading;
+        bool _selectionPending;
+
+        /* The number of messages in the thread, or -1 if not known yet */
         int _messageCount;
+
+        /* The number of messages in collapsed replies */
+        int _hiddenCount;
+
+        /* The messages in the order they are displayed */
+        std::vector<MessageLine> _messages;
 };
 
 #endif
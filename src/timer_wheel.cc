@@ -0,0 +1,150 @@
+/* ner: src/timer_wheel.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "timer_wheel.hh"
+
+const auto tickLength = std::chrono::milliseconds(10);
+
+/* The number of slots, enough for timers up to about 40 seconds away */
+const int wheelSize = 4096;
+
+/* Returns the number of ticks in the duration, rounded up */
+static uint64_t ticks(std::chrono::milliseconds duration)
+{
+    return (std::max<int64_t>(duration.count(), 0) + tickLength.count() - 1) / tickLength.count();
+}
+
+TimerWheel::TimerWheel()
+    : _start(Clock::now()), _tick(0), _slots(wheelSize), _nextId(1)
+{
+}
+
+int TimerWheel::add(std::chrono::milliseconds delay, const std::function<void ()> & callback,
+    std::chrono::milliseconds interval)
+{
+    int id = _nextId++;
+
+    insert(Timer{ id, currentTick() + ticks(delay), interval, callback });
+
+    return id;
+}
+
+void TimerWheel::cancel(int id)
+{
+    auto timer = _timers.find(id);
+
+    if (timer == _timers.end())
+        return;
+
+    _slots[timer->second->tick % wheelSize].erase(timer->second);
+    _timers.erase(timer);
+}
+
+int TimerWheel::timeUntilNext() const
+{
+    if (_timers.empty())
+        return -1;
+
+    for (uint64_t tick = _tick; tick < _tick + wheelSize; ++tick)
+    {
+        const Slot & slot = _slots[tick % wheelSize];
+
+        for (auto timer = slot.begin(), e = slot.end(); timer != e; ++timer)
+        {
+            if (timer->tick <= tick)
+            {
+                auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    _start + tick * tickLength - Clock::now());
+
+                return std::max<int>(delay.count(), 0);
+            }
+        }
+    }
+
+    return wheelSize * tickLength.count();
+}
+
+void TimerWheel::expire()
+{
+    uint64_t now = currentTick();
+
+    if (now < _tick)
+        return;
+
+    /* After a long time without expiring timers, look at each slot once */
+    uint64_t first = std::max(_tick, now >= wheelSize ? now - wheelSize + 1 : 0);
+    std::vector<int> expired;
+
+    for (uint64_t tick = first; tick <= now; ++tick)
+    {
+        const Slot & slot = _slots[tick % wheelSize];
+
+        for (auto timer = slot.begin(), e = slot.end(); timer != e; ++timer)
+        {
+            if (timer->tick <= now)
+                expired.push_back(timer->id);
+        }
+    }
+
+    _tick = now + 1;
+
+    for (auto id = expired.begin(), e = expired.end(); id != e; ++id)
+    {
+        /* An earlier callback may have cancelled the timer */
+        auto entry = _timers.find(*id);
+
+        if (entry == _timers.end())
+            continue;
+
+        Slot::iterator timer = entry->second;
+        std::function<void ()> callback(timer->callback);
+
+        if (timer->interval.count() > 0)
+        {
+            Timer next(std::move(*timer));
+            next.tick = std::max(next.tick + ticks(next.interval), _tick);
+
+            _slots[timer->tick % wheelSize].erase(timer);
+            insert(std::move(next));
+        }
+        else
+            cancel(*id);
+
+        callback();
+    }
+}
+
+uint64_t TimerWheel::currentTick() const
+{
+    return (Clock::now() - _start) / tickLength;
+}
+
+void TimerWheel::insert(Timer && timer)
+{
+    /* Don't put timers in slots we have already gone past */
+    timer.tick = std::max(timer.tick, _tick);
+
+    Slot & slot = _slots[timer.tick % wheelSize];
+    _timers[timer.id] = slot.insert(slot.end(), std::move(timer));
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
@@ -0,0 +1,100 @@
+/* ner: src/timer_wheel.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_TIMER_WHEEL_H
+#define NER_TIMER_WHEEL_H 1
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+/**
+ * A hashed timer wheel, for one-shot and periodic timers.
+ *
+ * Timers are hashed into slots by the tick they expire on, so adding,
+ * cancelling and expiring a timer take constant time. Timers fire with a
+ * resolution of one tick (10ms).
+ *
+ * The wheel does not keep time by itself; it is driven by calling expire()
+ * from the event loop.
+ */
+class TimerWheel
+{
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        TimerWheel();
+
+        /**
+         * Adds a timer.
+         *
+         * \param delay The time until the timer first fires.
+         * \param interval If non-zero, the timer fires again every interval
+         *                 until it is cancelled.
+         * \return An ID which can be passed to cancel().
+         */
+        int add(std::chrono::milliseconds delay, const std::function<void ()> & callback,
+            std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+        void cancel(int id);
+
+        bool empty() const { return _timers.empty(); }
+
+        /**
+         * Returns how long to wait until the next timer is due, or -1 if
+         * there are no timers.
+         *
+         * Timers more than a full turn of the wheel away are not looked for,
+         * so this may return earlier than the next timer is due.
+         */
+        int timeUntilNext() const;
+
+        /**
+         * Calls the callbacks of the timers which have expired.
+         */
+        void expire();
+
+    private:
+        struct Timer
+        {
+            int id;
+            uint64_t tick;
+            std::chrono::milliseconds interval;
+            std::function<void ()> callback;
+        };
+
+        typedef std::list<Timer> Slot;
+
+        uint64_t currentTick() const;
+        void insert(Timer && timer);
+
+        Clock::time_point _start;
+        uint64_t _tick;
+
+        std::vector<Slot> _slots;
+        std::unordered_map<int, Slot::iterator> _timers;
+        int _nextId;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
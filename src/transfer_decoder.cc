@@ -0,0 +1,325 @@
+/* ner: src/transfer_decoder.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "transfer_decoder.hh"
+#include "gmime_stream_reader.hh"
+
+/* Marks characters which are not part of the base64 alphabet */
+const unsigned char invalid = 0xff;
+
+static const struct Base64Table
+{
+    Base64Table()
+    {
+        const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::fill(values, values + 256, invalid);
+
+        for (int index = 0; index < 64; ++index)
+            values[static_cast<unsigned char>(alphabet[index])] = index;
+    }
+
+    unsigned char values[256];
+} base64Table;
+
+/* Decodes groups of four base64 characters, until one contains anything
+ * else, returning the number of characters decoded */
+static size_t decodeBase64Run(const char * data, size_t length, unsigned char * output)
+{
+    const unsigned char * input = reinterpret_cast<const unsigned char *>(data);
+    size_t position = 0;
+
+    for (; position + 4 <= length; position += 4, output += 3)
+    {
+        unsigned char a = base64Table.values[input[position]];
+        unsigned char b = base64Table.values[input[position + 1]];
+        unsigned char c = base64Table.values[input[position + 2]];
+        unsigned char d = base64Table.values[input[position + 3]];
+
+        if ((a | b | c | d) & 0xc0)
+            break;
+
+        uint32_t value = a << 18 | b << 12 | c << 6 | d;
+
+        output[0] = value >> 16;
+        output[1] = value >> 8;
+        output[2] = value;
+    }
+
+    return position;
+}
+
+/* Writes the bytes of an incomplete group, once its padding is reached */
+static unsigned char * finishBase64Group(uint32_t value, int count, unsigned char * output)
+{
+    if (count == 2)
+        *output++ = value >> 4;
+    else if (count == 3)
+    {
+        *output++ = value >> 10;
+        *output++ = value >> 2;
+    }
+
+    return output;
+}
+
+static const char * decodeBase64(const char * data, const char * end, std::string & output)
+{
+    size_t start = output.size();
+
+    /* An incomplete group at the padding adds up to two bytes */
+    output.resize(start + (end - data) / 4 * 3 + 2);
+
+    unsigned char * begin = reinterpret_cast<unsigned char *>(&output[start]);
+    unsigned char * position = begin;
+
+    while (data < end)
+    {
+        /* Most of the content is in long runs between line breaks */
+        size_t length = decodeBase64Run(data, end - data, position);
+
+        data += length;
+        position += length / 4 * 3;
+
+        /* Runs always end between groups, so line breaks can be skipped */
+        if (data < end && (*data == '\n' || *data == '\r'))
+        {
+            ++data;
+            continue;
+        }
+
+        /* Decode a group spanning a line break, or at the padding */
+        const char * group = data;
+        uint32_t value = 0;
+        int count = 0;
+        bool padded = false;
+
+        while (data < end && count < 4)
+        {
+            unsigned char character = *data++;
+
+            if (character == '=')
+            {
+                padded = true;
+                break;
+            }
+
+            unsigned char characterValue = base64Table.values[character];
+
+            if (characterValue != invalid)
+            {
+                value = value << 6 | characterValue;
+                ++count;
+            }
+        }
+
+        if (count == 4)
+        {
+            position[0] = value >> 16;
+            position[1] = value >> 8;
+            position[2] = value;
+            position += 3;
+        }
+        else if (padded)
+            position = finishBase64Group(value, count, position);
+        else
+        {
+            /* The group may be finished by the next block */
+            data = group;
+            break;
+        }
+    }
+
+    output.resize(start + (position - begin));
+
+    return data;
+}
+
+static int hexValue(char character)
+{
+    if (character >= '0' && character <= '9')
+        return character - '0';
+    else if (character >= 'A' && character <= 'F')
+        return character - 'A' + 10;
+    else if (character >= 'a' && character <= 'f')
+        return character - 'a' + 10;
+    else
+        return -1;
+}
+
+static const char * decodeQuotedPrintable(const char * data, const char * end, std::string & output)
+{
+    output.reserve(output.size() + (end - data));
+
+    while (data < end)
+    {
+        const char * escape = static_cast<const char *>(std::memchr(data, '=', end - data));
+
+        if (!escape)
+        {
+            output.append(data, end);
+            return end;
+        }
+
+        output.append(data, escape);
+        data = escape;
+
+        /* Wait for the rest of the escape from the next block */
+        if (end - data < 2 || (data[1] == '\r' && end - data < 3))
+            break;
+
+        /* Soft line breaks */
+        if (data[1] == '\n')
+        {
+            data += 2;
+            continue;
+        }
+        else if (data[1] == '\r' && data[2] == '\n')
+        {
+            data += 3;
+            continue;
+        }
+
+        if (end - data < 3)
+            break;
+
+        int high = hexValue(data[1]);
+        int low = hexValue(data[2]);
+
+        if (high != -1 && low != -1)
+        {
+            output.push_back(high << 4 | low);
+            data += 3;
+        }
+        else
+        {
+            /* Not really an escape, so leave it alone */
+            output.push_back('=');
+            ++data;
+        }
+    }
+
+    return data;
+}
+
+TransferDecoder::TransferDecoder(GMimeContentEncoding encoding)
+    : _encoding(encoding)
+{
+}
+
+bool TransferDecoder::handles(GMimeContentEncoding encoding)
+{
+    return encoding == GMIME_CONTENT_ENCODING_BASE64
+        || encoding == GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE;
+}
+
+void TransferDecoder::decode(const char * data, size_t length, std::string & output)
+{
+    /* Complete what was held back from the last block, which is only ever a
+     * few characters */
+    while (!_pending.empty() && length > 0)
+    {
+        _pending.push_back(*data++);
+        --length;
+
+        const char * rest = decodeBlock(_pending.data(), _pending.data() + _pending.size(), output);
+        _pending.erase(0, rest - _pending.data());
+    }
+
+    const char * rest = decodeBlock(data, data + length, output);
+    _pending.append(rest, data + length);
+}
+
+void TransferDecoder::finish(std::string & output)
+{
+    if (_pending.empty())
+        return;
+
+    if (_encoding == GMIME_CONTENT_ENCODING_BASE64)
+    {
+        /* Treat the end of the content like padding */
+        _pending.push_back('=');
+        decodeBlock(_pending.data(), _pending.data() + _pending.size(), output);
+    }
+    else
+        output.append(_pending);
+
+    _pending.clear();
+}
+
+const char * TransferDecoder::decodeBlock(const char * data, const char * end, std::string & output)
+{
+    if (_encoding == GMIME_CONTENT_ENCODING_BASE64)
+        return decodeBase64(data, end, output);
+    else
+        return decodeQuotedPrintable(data, end, output);
+}
+
+void readDecodedContent(GMimeDataWrapper * data,
+    const std::function<void (const char *, size_t)> & function)
+{
+    GMimeContentEncoding encoding = g_mime_data_wrapper_get_encoding(data);
+    GMimeStream * content = g_mime_data_wrapper_get_stream(data);
+
+    g_mime_stream_reset(content);
+
+    if (TransferDecoder::handles(encoding))
+    {
+        TransferDecoder decoder(encoding);
+        std::string output;
+
+        readStream(content, [&](const char * block, size_t length) {
+            decoder.decode(block, length, output);
+            function(output.data(), output.size());
+            output.clear();
+        });
+
+        decoder.finish(output);
+        function(output.data(), output.size());
+    }
+    else if (encoding == GMIME_CONTENT_ENCODING_UUENCODE)
+    {
+        /* This is rare enough to leave to GMime's filter */
+        GMimeStream * filterStream = g_mime_stream_filter_new(content);
+        GMimeFilter * filter = g_mime_filter_basic_new(encoding, FALSE);
+
+        g_mime_stream_filter_add(GMIME_STREAM_FILTER(filterStream), filter);
+        g_object_unref(filter);
+
+        readStream(filterStream, function);
+        g_object_unref(filterStream);
+    }
+    else
+        readStream(content, function);
+}
+
+void writeDecodedContent(GMimeDataWrapper * data, GMimeStream * stream)
+{
+    readDecodedContent(data, [stream](const char * block, size_t length) {
+        g_mime_stream_write(stream, block, length);
+    });
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
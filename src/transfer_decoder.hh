@@ -0,0 +1,79 @@
+/* ner: src/transfer_decoder.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_TRANSFER_DECODER_H
+#define NER_TRANSFER_DECODER_H 1
+
+#include <string>
+#include <functional>
+#include <gmime/gmime.h>
+
+/**
+ * Decodes base64 and quoted-printable content a block at a time.
+ *
+ * GMime's filters decode a byte at a time, which is slow for large
+ * attachments. Base64 is decoded a group of four characters at a time
+ * between line breaks, and quoted-printable text is copied in bulk between
+ * escapes.
+ */
+class TransferDecoder
+{
+    public:
+        TransferDecoder(GMimeContentEncoding encoding);
+
+        /**
+         * Returns whether the encoding is one we decode ourselves.
+         */
+        static bool handles(GMimeContentEncoding encoding);
+
+        /**
+         * Decodes the next block of content, appending it to the output.
+         *
+         * The end of the block may be held back until the next call.
+         */
+        void decode(const char * data, size_t length, std::string & output);
+
+        /**
+         * Decodes whatever was held back at the end of the content.
+         */
+        void finish(std::string & output);
+
+    private:
+        const char * decodeBlock(const char * data, const char * end, std::string & output);
+
+        GMimeContentEncoding _encoding;
+        std::string _pending;
+};
+
+/**
+ * Reads the content of the data wrapper, passing it to the function in
+ * blocks once its transfer encoding is decoded.
+ */
+void readDecodedContent(GMimeDataWrapper * data,
+    const std::function<void (const char *, size_t)> & function);
+
+/**
+ * Writes the decoded content of the data wrapper to the stream.
+ */
+void writeDecodedContent(GMimeDataWrapper * data, GMimeStream * stream);
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
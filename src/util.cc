@@ -21,8 +21,15 @@
 #include <stdio.h>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
+#include <unistd.h>
+#include <pwd.h>
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "util.hh"
+#include "event_loop.hh"
 
 #define MINUTE (60)
 #define HOUR (60 * MINUTE)
@@ -93,5 +100,68 @@ std::string formatByteSize(long size)
     return val.str();
 }
 
+std::string cacheDirectory()
+{
+    const char * cacheHome = std::getenv("XDG_CACHE_HOME");
+    std::string directory;
+
+    if (cacheHome && *cacheHome)
+        directory = cacheHome;
+    else
+    {
+        const char * home = std::getenv("HOME");
+
+        if (!home || !*home)
+        {
+            struct passwd * user = getpwuid(getuid());
+
+            /* Without any home directory, use somewhere which is writable */
+            home = user && user->pw_dir ? user->pw_dir : "/tmp";
+        }
+
+        directory = std::string(home) + "/.cache";
+        mkdir(directory.c_str(), 0700);
+    }
+
+    directory.append("/ner");
+    mkdir(directory.c_str(), 0700);
+
+    return directory;
+}
+
+pid_t spawnCommand(const std::string & command, int input, int output)
+{
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        EventLoop::unblockSignals();
+
+        if (input != -1)
+            dup2(input, 0);
+
+        if (output != -1)
+            dup2(output, 1);
+
+        execlp("sh", "sh", "-c", command.c_str(), NULL);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+int waitForProcess(pid_t pid)
+{
+    int status;
+
+    while (waitpid(pid, &status, 0) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+
+    return status;
+}
+
 // vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
 
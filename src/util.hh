@@ -23,9 +23,9 @@
 
 #include <string>
 #include <time.h>
+#include <sys/types.h>
 #include <gmime/gmime.h>
 
-#include "gmime_iostream.hh"
 #include "ncurses.hh"
 #include "ner_config.hh"
 #include "message_part.hh"
@@ -34,6 +34,32 @@ std::string relativeTime(time_t rawTime);
 
 std::string formatByteSize(long size);
 
+/**
+ * Returns the directory in which ner keeps its caches, creating it if
+ * necessary.
+ */
+std::string cacheDirectory();
+
+/**
+ * Starts the command with the shell, without the signals blocked by the
+ * event loop.
+ *
+ * \param input If not -1, the file descriptor to use as the command's
+ *              standard input.
+ * \param output If not -1, the file descriptor to use as the command's
+ *               standard output.
+ *
+ * \return The ID of the process, or -1 if it could not be started.
+ */
+pid_t spawnCommand(const std::string & command, int input = -1, int output = -1);
+
+/**
+ * Waits for the process to exit.
+ *
+ * \return The status of the process as given by waitpid, or -1.
+ */
+int waitForProcess(pid_t pid);
+
 template <typename Type>
     struct addressOf : public std::unary_function<Type, Type *>
 {
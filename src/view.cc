@@ -50,6 +50,10 @@ void View::unfocus()
 {
 }
 
+void View::databaseChanged()
+{
+}
+
 std::vector<std::string> View::status() const
 {
     return std::vector<std::string>();
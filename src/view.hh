@@ -79,6 +79,11 @@ class View : public InputHandler
         virtual std::string name() const = 0;
         virtual std::vector<std::string> status() const;
 
+        /**
+         * Called when the notmuch database has changed.
+         */
+        virtual void databaseChanged();
+
     protected:
         Geometry _geometry;
 
@@ -23,10 +23,15 @@
 #include "view.hh"
 #include "view_view.hh"
 #include "status_bar.hh"
+#include "event_loop.hh"
+
+/* The minimum time between updates requested through requestUpdate() */
+const auto minimumUpdateInterval = std::chrono::milliseconds(100);
 
 ViewManager * ViewManager::_instance = 0;
 
 ViewManager::ViewManager()
+    : _updateTimer(0)
 {
     _instance = this;
 
@@ -35,6 +40,8 @@ ViewManager::ViewManager()
 
 ViewManager::~ViewManager()
 {
+    if (_updateTimer)
+        EventLoop::instance().cancelTimer(_updateTimer);
 }
 
 InputHandler::HandleResult ViewManager::handleKeySequence(const std::vector<int> & sequence)
@@ -96,6 +103,7 @@ void ViewManager::closeActiveView()
 void ViewManager::update()
 {
     _activeView->update();
+    _lastUpdate = std::chrono::steady_clock::now();
 }
 
 void ViewManager::refresh()
@@ -103,6 +111,31 @@ void ViewManager::refresh()
     _activeView->refresh();
 }
 
+void ViewManager::requestUpdate()
+{
+    if (_updateTimer)
+        return;
+
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+        _lastUpdate + minimumUpdateInterval - std::chrono::steady_clock::now());
+
+    _updateTimer = EventLoop::instance().addTimer(
+        std::max(delay, std::chrono::milliseconds(0)), [this] {
+            _updateTimer = 0;
+
+            update();
+            refresh();
+        });
+}
+
+void ViewManager::databaseChanged()
+{
+    for (auto view = _views.begin(), e = _views.end(); view != e; ++view)
+        (*view)->databaseChanged();
+
+    requestUpdate();
+}
+
 void ViewManager::resize()
 {
     for (auto view = _views.begin(), e = _views.end(); view != e; ++view)
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <memory>
+#include <chrono>
 
 #include "input_handler.hh"
 
@@ -71,6 +72,19 @@ class ViewManager : public InputHandler
         void refresh();
         void resize();
 
+        /**
+         * Updates and refreshes the active view soon, but not more often
+         * than every 100ms.
+         *
+         * This is meant for views with results arriving in the background.
+         */
+        void requestUpdate();
+
+        /**
+         * Tells all views that the notmuch database has changed.
+         */
+        void databaseChanged();
+
         const View & activeView() const;
 
     private:
@@ -82,6 +96,9 @@ class ViewManager : public InputHandler
         std::shared_ptr<View> _activeView;
         std::vector<std::shared_ptr<View>> _views;
 
+        std::chrono::steady_clock::time_point _lastUpdate;
+        int _updateTimer;
+
     friend class ViewView;
 };
 
@@ -0,0 +1,97 @@
+/* ner: src/worker_pool.cc
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "worker_pool.hh"
+#include "event_loop.hh"
+
+WorkerPool * WorkerPool::_instance = 0;
+
+WorkerPool::WorkerPool(int threads)
+    : _stopping(false)
+{
+    _instance = this;
+
+    for (int index = 0; index < threads; ++index)
+        _threads.push_back(std::thread(std::bind(&WorkerPool::run, this)));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        /* Drop anything that hasn't started yet */
+        _jobs.clear();
+        _stopping = true;
+    }
+
+    _condition.notify_all();
+
+    for (auto thread = _threads.begin(), e = _threads.end(); thread != e; ++thread)
+        thread->join();
+
+    _instance = 0;
+}
+
+void WorkerPool::post(const std::function<void ()> & job, const std::function<void ()> & done)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::make_pair(job, done));
+    }
+
+    _condition.notify_one();
+}
+
+void WorkerPool::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true)
+    {
+        _condition.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+        if (_stopping)
+            break;
+
+        std::function<void ()> job(std::move(_jobs.front().first));
+        std::function<void ()> done(std::move(_jobs.front().second));
+        _jobs.pop_front();
+
+        lock.unlock();
+
+        try
+        {
+            job();
+        }
+        catch (const std::exception & e)
+        {
+            /* There is nobody to report this to from here; the job is
+             * responsible for leaving its shared state consistent. */
+        }
+
+        if (done)
+            EventLoop::instance().post(done);
+
+        lock.lock();
+    }
+}
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+
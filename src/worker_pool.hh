@@ -0,0 +1,74 @@
+/* ner: src/worker_pool.hh
+ *
+ * Copyright (c) 2012 Michael Forney
+ *
+ * This file is a part of ner.
+ *
+ * ner is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License version 3, as published by the Free
+ * Software Foundation.
+ *
+ * ner is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ner.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NER_WORKER_POOL_H
+#define NER_WORKER_POOL_H 1
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * Runs jobs on a small set of background threads.
+ *
+ * Jobs must not touch ncurses, and must not refer to views directly, since
+ * the view may be closed before the job runs. Share state with the job
+ * through a std::shared_ptr instead, and use the completion callback to
+ * update the screen.
+ *
+ * This class is a singleton.
+ */
+class WorkerPool
+{
+    public:
+        static WorkerPool & instance()
+        {
+            return *_instance;
+        }
+
+        WorkerPool(int threads = 2);
+        ~WorkerPool();
+
+        /**
+         * Queues a job to be run on one of the worker threads.
+         *
+         * \param done If set, posted to the EventLoop once the job is done.
+         */
+        void post(const std::function<void ()> & job,
+            const std::function<void ()> & done = std::function<void ()>());
+
+    private:
+        static WorkerPool * _instance;
+
+        void run();
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::deque<std::pair<std::function<void ()>, std::function<void ()>>> _jobs;
+        std::vector<std::thread> _threads;
+        bool _stopping;
+};
+
+#endif
+
+// vim: fdm=syntax fo=croql et sw=4 sts=4 ts=8
+